@@ -0,0 +1,114 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+#include <cstdlib>
+#include <new>
+
+// Counts the C++ heap allocations of the whole program when built with
+// BOAT_RUNNER_COUNT_ALLOCATIONS (make Debug), to check that the steady state loops never allocate.
+// It replaces the global operator new and delete, so it must be included by one translation unit only.
+// Memory allocated by C libraries, like the Vulkan driver, is not counted
+
+#ifdef BOAT_RUNNER_COUNT_ALLOCATIONS
+const bool ALLOCATION_COUNTING = true;
+#else
+const bool ALLOCATION_COUNTING = false;
+#endif
+
+inline std::atomic<unsigned long> &allocationCounter()
+{
+    static std::atomic<unsigned long> counter{0};
+    return counter;
+}
+
+// Allocations so far, always 0 without BOAT_RUNNER_COUNT_ALLOCATIONS
+inline unsigned long allocationCount()
+{
+    return allocationCounter().load(std::memory_order_relaxed);
+}
+
+#ifdef BOAT_RUNNER_COUNT_ALLOCATIONS
+
+inline void *countedAllocation(std::size_t size, std::size_t alignment)
+{
+    allocationCounter().fetch_add(1, std::memory_order_relaxed);
+
+    if (size == 0)
+    {
+        size = 1;
+    }
+
+    void *memory = alignment <= alignof(std::max_align_t)
+                       ? std::malloc(size)
+                       : std::aligned_alloc(alignment, (size + alignment - 1) / alignment * alignment);
+
+    if (memory == nullptr)
+    {
+        throw std::bad_alloc();
+    }
+
+    return memory;
+}
+
+void *operator new(std::size_t size)
+{
+    return countedAllocation(size, 0);
+}
+
+void *operator new[](std::size_t size)
+{
+    return countedAllocation(size, 0);
+}
+
+void *operator new(std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocation(size, static_cast<std::size_t>(alignment));
+}
+
+void *operator new[](std::size_t size, std::align_val_t alignment)
+{
+    return countedAllocation(size, static_cast<std::size_t>(alignment));
+}
+
+void operator delete(void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete(void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+void operator delete[](void *memory, std::size_t, std::align_val_t) noexcept
+{
+    std::free(memory);
+}
+
+#endif
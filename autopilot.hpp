@@ -0,0 +1,170 @@
+#pragma once
+
+#include <algorithm>
+#include <cstdint>
+#include <vector>
+
+#include "game_core.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+// Rollouts per decision, split evenly between the three directions
+const int AUTOPILOT_ROLLOUTS = 240;
+
+// Steps simulated by each rollout
+const int AUTOPILOT_HORIZON_STEPS = 480;
+
+// Steps a direction is held, both by the autopilot and inside the rollouts
+const int AUTOPILOT_DECISION_STEPS = 24;
+
+// Rollout tasks per thread of the pool, to even out rollouts that end early
+const int AUTOPILOT_TASKS_PER_THREAD = 4;
+
+// Plays the game by itself, for soak runs and load tests. Every AUTOPILOT_DECISION_STEPS
+// it snapshots the game, plays AUTOPILOT_ROLLOUTS short games from there on copies of it,
+// each one starting with one of the three directions and then steering at random,
+// and takes the direction whose rollouts survived longest overall.
+// Rollouts are spread over the pool, but their steering only depends on their index,
+// so the autopilot makes the same choices whatever the number of threads
+class Autopilot
+{
+    // Optional workers, not owned
+    ThreadPool *pool = nullptr;
+
+    // One copy of the game per task, restored from root for every rollout
+    std::vector<GameCore> cores;
+    GameSnapshot root;
+    std::vector<int> survived;
+
+    int direction = 0;
+    int heldSteps = 0;
+    uint64_t decisions = 0;
+
+    // Steps the rollout survived, the whole horizon if it did not lose
+    int rollout(GameCore &sim, int r)
+    {
+        sim.loadSnapshot(root);
+
+        uint64_t state = decisions * AUTOPILOT_ROLLOUTS + r;
+        RngStream random;
+        random.seed(splitMix64(state));
+
+        int horDir = r % 3 - 1;
+
+        for (int s = 0; s < AUTOPILOT_HORIZON_STEPS; ++s)
+        {
+            if (s > 0 && s % AUTOPILOT_DECISION_STEPS == 0)
+            {
+                horDir = std::min(2, static_cast<int>(random.uniform(0.0f, 3.0f))) - 1;
+            }
+
+            GameEvent event = sim.step(SIM_STEP, horDir);
+
+            if (event == Lose)
+            {
+                return s;
+            }
+            else if (event == Win)
+            {
+                break;
+            }
+        }
+
+        return AUTOPILOT_HORIZON_STEPS;
+    }
+
+    void decide(const GameCore &core)
+    {
+        core.saveSnapshot(root);
+
+        const int tasks = cores.size();
+        auto task = [&](int t)
+        {
+            for (int r = t; r < AUTOPILOT_ROLLOUTS; r += tasks)
+            {
+                survived[r] = rollout(cores[t], r);
+            }
+        };
+
+        if (pool != nullptr)
+        {
+            pool->run(tasks, task);
+        }
+        else
+        {
+            task(0);
+        }
+
+        long score[3] = {0, 0, 0};
+        for (int r = 0; r < AUTOPILOT_ROLLOUTS; ++r)
+        {
+            score[r % 3] += survived[r];
+            rolloutSteps += survived[r];
+        }
+
+        // Ties keep the current direction
+        int best = direction;
+        for (int d = -1; d <= 1; ++d)
+        {
+            if (score[d + 1] > score[best + 1])
+            {
+                best = d;
+            }
+        }
+
+        direction = best;
+        decisions++;
+    }
+
+public:
+    // Steps simulated by all the rollouts so far
+    long rolloutSteps = 0;
+
+    // Sets up the copies of core the rollouts run on. core must own its rocks
+    void init(const GameCore &core, ThreadPool *workers = nullptr)
+    {
+        pool = workers;
+
+        const int tasks = pool != nullptr ? std::min(AUTOPILOT_ROLLOUTS, AUTOPILOT_TASKS_PER_THREAD * pool->size()) : 1;
+
+        // Copies run serially on their task, and generate their own course chunks
+        cores.assign(tasks, core);
+        for (auto &sim : cores)
+        {
+            sim.pool = nullptr;
+            sim.courseStream = nullptr;
+            sim.timings = nullptr;
+            sim.spawnTable.detachStream();
+            sim.reserveScratch();
+        }
+
+        survived.assign(AUTOPILOT_ROLLOUTS, 0);
+
+        // Sized once here, so that deciding never allocates
+        core.saveSnapshot(root);
+
+        direction = 0;
+        heldSteps = 0;
+        decisions = 0;
+        rolloutSteps = 0;
+    }
+
+    // Direction to steer core in for its next step
+    int steer(const GameCore &core)
+    {
+        if (heldSteps == 0)
+        {
+            decide(core);
+            heldSteps = AUTOPILOT_DECISION_STEPS;
+        }
+
+        heldSteps--;
+        return direction;
+    }
+
+    // Decides afresh at the next step, e.g. after a restart
+    void reset()
+    {
+        heldSteps = 0;
+    }
+};
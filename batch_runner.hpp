@@ -0,0 +1,131 @@
+#pragma once
+
+#include <cstdint>
+#include <vector>
+
+#include "game_core.hpp"
+#include "rng.hpp"
+#include "thread_pool.hpp"
+
+// Environments stepped together by one pool task
+const int BATCH_ENVS_PER_TASK = 8;
+
+// Many independent games stepped in lockstep, e.g. to tune the difficulty constants.
+// The rocks of all the environments are laid out in one block, environment after
+// environment, each one attached to its slice, and every step is a single pass over
+// the pool: each task advances a group of neighbouring environments end to end
+class BatchRunner
+{
+    std::vector<float> columns;
+    std::vector<int> kinds;
+
+    // Optional workers, not owned
+    ThreadPool *pool = nullptr;
+
+public:
+    std::vector<GameCore> envs;
+
+    // Result of the last step of each environment; finished ones are already restarted
+    std::vector<GameEvent> events;
+
+    long steps = 0;
+    long episodes = 0;
+    long wins = 0;
+
+    // Environment e is seeded from seed, so the whole batch is reproducible
+    // and does not depend on the number of threads
+    void init(uint64_t seed, int count, const ModelBoundaries &boat, const std::vector<RockKind> &rockKinds,
+              const std::vector<int> &counts, const ConvexHull &boatHull = ConvexHull(), ThreadPool *workers = nullptr)
+    {
+        pool = workers;
+
+        int rocksPerEnv = 0;
+        for (int n : counts)
+        {
+            rocksPerEnv += n;
+        }
+
+        columns.assign(static_cast<size_t>(count) * ROCK_COLUMNS * rocksPerEnv, 0.0f);
+        kinds.assign(static_cast<size_t>(count) * rocksPerEnv, 0);
+
+        // Sized once: the environments must not move after attaching their rocks
+        envs.clear();
+        envs.resize(count);
+        events.assign(count, Playing);
+
+        uint64_t state = seed;
+        for (int e = 0; e < count; ++e)
+        {
+            envs[e].rocks.attach(columns.data() + static_cast<size_t>(e) * ROCK_COLUMNS * rocksPerEnv,
+                                 kinds.data() + static_cast<size_t>(e) * rocksPerEnv, rocksPerEnv);
+            envs[e].init(splitMix64(state), boat, rockKinds, counts, boatHull);
+        }
+
+        steps = 0;
+        episodes = 0;
+        wins = 0;
+    }
+
+    int size() const
+    {
+        return envs.size();
+    }
+
+    // Advances every environment by SIM_STEP, environment e steering in actions[e] (-1, 0, 1).
+    // Returns how many episodes ended
+    int step(const int *actions)
+    {
+        const int n = envs.size();
+        const int tasks = (n + BATCH_ENVS_PER_TASK - 1) / BATCH_ENVS_PER_TASK;
+
+        auto task = [&](int t)
+        {
+            const int last = std::min(n, (t + 1) * BATCH_ENVS_PER_TASK);
+
+            for (int e = t * BATCH_ENVS_PER_TASK; e < last; ++e)
+            {
+                events[e] = envs[e].step(SIM_STEP, actions[e]);
+
+                if (events[e] != Playing)
+                {
+                    envs[e].restart();
+                }
+            }
+        };
+
+        if (pool != nullptr)
+        {
+            pool->run(tasks, task);
+        }
+        else
+        {
+            for (int t = 0; t < tasks; ++t)
+            {
+                task(t);
+            }
+        }
+
+        int ended = 0;
+        for (int e = 0; e < n; ++e)
+        {
+            ended += events[e] != Playing;
+            wins += events[e] == Win;
+        }
+
+        steps += n;
+        episodes += ended;
+
+        return ended;
+    }
+
+    int highscore() const
+    {
+        int best = 0;
+        for (const auto &env : envs)
+        {
+            best = std::max(best, env.game.highscore);
+        }
+
+        return best;
+    }
+};
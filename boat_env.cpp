@@ -0,0 +1,387 @@
+#include "boat_env.h"
+
+#include <cmath>
+#include <limits>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+#define GLM_FORCE_RADIANS
+#define GLM_FORCE_DEFAULT_ALIGNED_GENTYPES
+#define GLM_FORCE_DEPTH_ZERO_TO_ONE
+#include <glm/glm.hpp>
+
+#define TINYOBJLOADER_IMPLEMENTATION
+#include <tiny_obj_loader.h>
+
+#include "convex_hull.hpp"
+#include "game_core.hpp"
+#include "observation_ring.hpp"
+
+static_assert(int(BOAT_ENV_ROCK_COLUMNS) == int(ROCK_COLUMNS) && int(BOAT_ENV_ROCK_X) == int(ColumnX) &&
+                  int(BOAT_ENV_ROCK_MAX_Z) == int(ColumnMaxZ),
+              "boat_env.h rock columns must match RockColumn");
+static_assert(sizeof(int) == sizeof(int32_t), "rock kinds are exposed as int32_t");
+static_assert(sizeof(BoatEnvObservation) % 8 == 0, "the rock arrays must stay aligned");
+static_assert(BOAT_ENV_PLAYING == Playing && BOAT_ENV_WIN == Win && BOAT_ENV_LOSE == Lose,
+              "boat_env.h events must match GameEvent");
+
+struct BoatEnv
+{
+    GameCore core;
+    BoatEnvObservation *observation = nullptr;
+    ObservationRing ring;
+};
+
+struct BoatEnvRing
+{
+    ObservationRing ring;
+};
+
+static thread_local std::string lastError;
+
+// Runs f, turning exceptions into an error return
+template <typename F, typename R>
+static R guard(F f, R error)
+{
+    try
+    {
+        return f();
+    }
+    catch (const std::exception &e)
+    {
+        lastError = e.what();
+    }
+    catch (...)
+    {
+        lastError = "unknown error";
+    }
+
+    return error;
+}
+
+static ModelBoundaries toBoundaries(const float b[6])
+{
+    return {b[0], b[1], b[2], b[3], b[4], b[5]};
+}
+
+static ConvexHull toHull(const float points[][2], int count)
+{
+    if (count < 0 || count > BOAT_ENV_MAX_HULL_POINTS)
+    {
+        throw std::runtime_error("hull point counts must be between 0 and BOAT_ENV_MAX_HULL_POINTS!");
+    }
+
+    ConvexHull hull;
+    for (int i = 0; i < count; ++i)
+    {
+        hull.push_back(glm::vec2(points[i][0], points[i][1]));
+    }
+
+    return hull;
+}
+
+// Boundaries, and hull if asked for, of an OBJ model: same as Model::computeBoundaries
+static void loadShape(const char *objPath, float boundaries[6], float hull[][2], int *hullCount)
+{
+    tinyobj::attrib_t attrib;
+    std::vector<tinyobj::shape_t> shapes;
+    std::vector<tinyobj::material_t> materials;
+    std::string warn, err;
+
+    if (!tinyobj::LoadObj(&attrib, &shapes, &materials, &warn, &err, objPath) || attrib.vertices.empty())
+    {
+        throw std::runtime_error(warn + err);
+    }
+
+    for (int axis = 0; axis < 3; ++axis)
+    {
+        float min = std::numeric_limits<float>::max();
+        float max = std::numeric_limits<float>::lowest();
+
+        for (size_t i = axis; i < attrib.vertices.size(); i += 3)
+        {
+            min = std::min(min, attrib.vertices[i]);
+            max = std::max(max, attrib.vertices[i]);
+        }
+
+        boundaries[axis] = std::abs(min);
+        boundaries[3 + axis] = std::abs(max);
+    }
+
+    if (hull == nullptr)
+    {
+        return;
+    }
+
+    std::vector<glm::vec2> points;
+    points.reserve(attrib.vertices.size() / 3);
+    for (size_t i = 0; i + 2 < attrib.vertices.size(); i += 3)
+    {
+        points.push_back(glm::vec2(attrib.vertices[i], attrib.vertices[i + 2]));
+    }
+
+    const ConvexHull outline = computeConvexHull(points);
+    if (outline.size() > BOAT_ENV_MAX_HULL_POINTS)
+    {
+        throw std::runtime_error("the model hull has more than BOAT_ENV_MAX_HULL_POINTS points!");
+    }
+
+    for (size_t i = 0; i < outline.size(); ++i)
+    {
+        hull[i][0] = outline[i].x;
+        hull[i][1] = outline[i].y;
+    }
+    *hullCount = outline.size();
+}
+
+static int rockTotal(const BoatEnvConfig &config)
+{
+    if (config.rockKindCount < 1 || config.rockKindCount > BOAT_ENV_MAX_ROCK_KINDS)
+    {
+        throw std::runtime_error("rockKindCount must be between 1 and BOAT_ENV_MAX_ROCK_KINDS!");
+    }
+
+    int total = 0;
+    for (int k = 0; k < config.rockKindCount; ++k)
+    {
+        if (config.rockCounts[k] < 0)
+        {
+            throw std::runtime_error("rock counts cannot be negative!");
+        }
+        total += config.rockCounts[k];
+    }
+
+    if (total == 0)
+    {
+        throw std::runtime_error("the course needs at least one rock!");
+    }
+
+    return total;
+}
+
+static size_t observationSize(int rocks)
+{
+    return sizeof(BoatEnvObservation) + static_cast<size_t>(rocks) * (ROCK_COLUMNS * sizeof(float) + sizeof(int32_t));
+}
+
+// Refreshes the header; the rocks are simulated in place
+static void writeObservation(BoatEnv &env, int event)
+{
+    const GameCore &core = env.core;
+    BoatEnvObservation &o = *env.observation;
+
+    o.points = core.game.points;
+    o.highscore = core.game.highscore;
+    o.done = !core.game.started;
+    o.event = event;
+
+    o.boatX = core.boatPosition.x;
+    o.boatZ = core.boatPosition.z;
+    o.boatYaw = core.boatRotation.y;
+
+    if (env.ring.isOpen())
+    {
+        env.ring.publish(env.observation);
+    }
+}
+
+const char *boat_env_last_error(void)
+{
+    return lastError.c_str();
+}
+
+int boat_env_load_boundaries(const char *objPath, float boundaries[6])
+{
+    return guard([&]
+                 {
+        loadShape(objPath, boundaries, nullptr, nullptr);
+        return 0; },
+                 -1);
+}
+
+int boat_env_load_shape(const char *objPath, float boundaries[6], float hull[BOAT_ENV_MAX_HULL_POINTS][2], int *hullCount)
+{
+    return guard([&]
+                 {
+        loadShape(objPath, boundaries, hull, hullCount);
+        return 0; },
+                 -1);
+}
+
+int boat_env_default_config(BoatEnvConfig *config, const char *modelDir)
+{
+    *config = BoatEnvConfig{};
+
+    const std::string dir = modelDir != nullptr ? modelDir : "models";
+
+    config->rockKindCount = 2;
+    config->rockCounts[0] = ROCK1_NUMBER;
+    config->rockCounts[1] = ROCK2_NUMBER;
+    config->rockScales[0] = ROCK1_DEFAULT_SCALE;
+    config->rockScales[1] = ROCK2_DEFAULT_SCALE;
+
+    if (boat_env_load_shape((dir + "/boat.obj").c_str(), config->boatBoundaries, config->boatHull, &config->boatHullCount) != 0 ||
+        boat_env_load_shape((dir + "/rock1.obj").c_str(), config->rockBoundaries[0], config->rockHulls[0], &config->rockHullCounts[0]) != 0 ||
+        boat_env_load_shape((dir + "/rock2.obj").c_str(), config->rockBoundaries[1], config->rockHulls[1], &config->rockHullCounts[1]) != 0)
+    {
+        return -1;
+    }
+
+    return 0;
+}
+
+size_t boat_env_observation_size(const BoatEnvConfig *config)
+{
+    return guard([&]
+                 { return observationSize(rockTotal(*config)); },
+                 static_cast<size_t>(0));
+}
+
+BoatEnv *boat_env_create(uint64_t seed, const BoatEnvConfig *config, void *observation, size_t size)
+{
+    return guard([&]
+                 {
+        const int total = rockTotal(*config);
+
+        if (observation == nullptr || reinterpret_cast<uintptr_t>(observation) % 8 != 0)
+        {
+            throw std::runtime_error("the observation buffer must be 8 bytes aligned!");
+        }
+        if (size < observationSize(total))
+        {
+            throw std::runtime_error("the observation buffer is too small!");
+        }
+
+        std::vector<RockKind> kinds;
+        std::vector<int> counts;
+        for (int k = 0; k < config->rockKindCount; ++k)
+        {
+            kinds.push_back(RockKind{config->rockScales[k], toBoundaries(config->rockBoundaries[k]),
+                                     toHull(config->rockHulls[k], config->rockHullCounts[k])});
+            counts.push_back(config->rockCounts[k]);
+        }
+
+        BoatEnv *env = new BoatEnv;
+        env->observation = static_cast<BoatEnvObservation *>(observation);
+
+        BoatEnvObservation &o = *env->observation;
+        o = BoatEnvObservation{};
+        o.rockCount = total;
+
+        float *columns = reinterpret_cast<float *>(env->observation + 1);
+        env->core.rocks.attach(columns, reinterpret_cast<int *>(columns + ROCK_COLUMNS * total), total);
+
+        try
+        {
+            env->core.init(seed, toBoundaries(config->boatBoundaries), kinds, counts,
+                           toHull(config->boatHull, config->boatHullCount));
+        }
+        catch (...)
+        {
+            delete env;
+            throw;
+        }
+
+        const ModelBoundaries &boat = env->core.boatBoundaries;
+        o.boatMinX = boat.minX * env->core.boatScale;
+        o.boatMaxX = boat.maxX * env->core.boatScale;
+        o.boatMinZ = boat.minZ * env->core.boatScale;
+        o.boatMaxZ = boat.maxZ * env->core.boatScale;
+
+        writeObservation(*env, Playing);
+        return env; },
+                 static_cast<BoatEnv *>(nullptr));
+}
+
+void boat_env_destroy(BoatEnv *env)
+{
+    delete env;
+}
+
+int boat_env_step(BoatEnv *env, int action)
+{
+    if (action < BOAT_ENV_LEFT || action > BOAT_ENV_RIGHT)
+    {
+        lastError = "action must be -1, 0 or 1";
+        return -1;
+    }
+
+    if (!env->core.game.started)
+    {
+        return env->observation->event;
+    }
+
+    GameEvent event = env->core.step(SIM_STEP, action);
+
+    env->observation->step++;
+    writeObservation(*env, event);
+
+    return event;
+}
+
+int boat_env_reset(BoatEnv *env)
+{
+    env->core.restart();
+
+    env->observation->episode++;
+    writeObservation(*env, Playing);
+
+    return 0;
+}
+
+int boat_env_publish(BoatEnv *env, const char *ringName, int slotCount)
+{
+    return guard([&]
+                 {
+        env->ring.create(ringName, slotCount, observationSize(env->observation->rockCount));
+        env->ring.publish(env->observation);
+        return 0; },
+                 -1);
+}
+
+BoatEnvRing *boat_env_ring_open(const char *ringName)
+{
+    return guard([&]
+                 {
+        BoatEnvRing *ring = new BoatEnvRing;
+
+        try
+        {
+            ring->ring.open(ringName);
+        }
+        catch (...)
+        {
+            delete ring;
+            throw;
+        }
+
+        return ring; },
+                 static_cast<BoatEnvRing *>(nullptr));
+}
+
+void boat_env_ring_close(BoatEnvRing *ring)
+{
+    delete ring;
+}
+
+size_t boat_env_ring_observation_size(const BoatEnvRing *ring)
+{
+    return ring->ring.recordSize();
+}
+
+uint64_t boat_env_ring_count(const BoatEnvRing *ring)
+{
+    return ring->ring.count();
+}
+
+int boat_env_ring_read(BoatEnvRing *ring, uint64_t index, void *out, size_t outSize)
+{
+    if (outSize < ring->ring.recordSize())
+    {
+        lastError = "the output buffer is too small";
+        return -1;
+    }
+
+    return ring->ring.read(index, out) ? 0 : 1;
+}
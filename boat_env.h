@@ -0,0 +1,153 @@
+#ifndef BOAT_ENV_H
+#define BOAT_ENV_H
+
+/*
+ * C interface to the game logic, for agents and tuning tools living outside BoatRunner.
+ *
+ * The caller owns the observation buffer: the environment simulates its rocks directly
+ * inside it, so stepping writes the observation in place, with no copy and no allocation.
+ * Optionally each observation is also published to a shared memory ring, for another
+ * process to consume.
+ *
+ * Functions returning int give 0 on success and -1 on error, see boat_env_last_error.
+ */
+
+#include <stddef.h>
+#include <stdint.h>
+
+#ifdef __cplusplus
+extern "C"
+{
+#endif
+
+#define BOAT_ENV_MAX_ROCK_KINDS 4
+#define BOAT_ENV_MAX_HULL_POINTS 128
+
+/* Actions: steering direction */
+#define BOAT_ENV_LEFT -1
+#define BOAT_ENV_STRAIGHT 0
+#define BOAT_ENV_RIGHT 1
+
+/* Events */
+#define BOAT_ENV_PLAYING 0
+#define BOAT_ENV_WIN 1
+#define BOAT_ENV_LOSE 2
+
+/* Rock arrays following the observation header, each rockCount floats long */
+enum BoatEnvRockColumn
+{
+    BOAT_ENV_ROCK_X,
+    BOAT_ENV_ROCK_Z,
+    BOAT_ENV_ROCK_PREVIOUS_X,
+    BOAT_ENV_ROCK_PREVIOUS_Z,
+    BOAT_ENV_ROCK_SCALE,
+    BOAT_ENV_ROCK_MIN_X,
+    BOAT_ENV_ROCK_MAX_X,
+    BOAT_ENV_ROCK_MIN_Z,
+    BOAT_ENV_ROCK_MAX_Z,
+    BOAT_ENV_ROCK_COLUMNS
+};
+
+/* Model boundaries: distances of the model faces from its origin,
+   in the order minX, minY, minZ, maxX, maxY, maxZ.
+   Model hulls: outline of the model seen from above, counterclockwise (x, z) points in model
+   space, for the collision narrowphase. A boat or rock kind without one (0 points) collides
+   with its boundaries box alone */
+typedef struct BoatEnvConfig
+{
+    float boatBoundaries[6];
+    int boatHullCount;
+    float boatHull[BOAT_ENV_MAX_HULL_POINTS][2];
+
+    int rockKindCount;
+    int rockCounts[BOAT_ENV_MAX_ROCK_KINDS];
+    float rockScales[BOAT_ENV_MAX_ROCK_KINDS];
+    float rockBoundaries[BOAT_ENV_MAX_ROCK_KINDS][6];
+    int rockHullCounts[BOAT_ENV_MAX_ROCK_KINDS];
+    float rockHulls[BOAT_ENV_MAX_ROCK_KINDS][BOAT_ENV_MAX_HULL_POINTS][2];
+} BoatEnvConfig;
+
+/* Start of the observation buffer. It is followed by BOAT_ENV_ROCK_COLUMNS float arrays
+   and then by an int32_t array of rock kinds, all rockCount long.
+   Rock extents are measured from the rock position, like the boat ones */
+typedef struct BoatEnvObservation
+{
+    uint64_t step;
+    int32_t episode;
+    int32_t points;
+    int32_t highscore;
+    int32_t done;
+    int32_t event;
+    int32_t rockCount;
+
+    float boatX;
+    float boatZ;
+    float boatYaw;
+    float boatMinX;
+    float boatMaxX;
+    float boatMinZ;
+    float boatMaxZ;
+    float reserved;
+} BoatEnvObservation;
+
+typedef struct BoatEnv BoatEnv;
+typedef struct BoatEnvRing BoatEnvRing;
+
+/* Message of the last error on the calling thread */
+const char *boat_env_last_error(void);
+
+/* Boundaries of a Wavefront OBJ model */
+int boat_env_load_boundaries(const char *objPath, float boundaries[6]);
+
+/* Boundaries and hull of a Wavefront OBJ model, as BoatRunner computes them */
+int boat_env_load_shape(const char *objPath, float boundaries[6], float hull[BOAT_ENV_MAX_HULL_POINTS][2], int *hullCount);
+
+/* The game configuration, with the models loaded from modelDir (e.g. "models") */
+int boat_env_default_config(BoatEnvConfig *config, const char *modelDir);
+
+/* Bytes needed by the observation buffer, 0 for an invalid configuration */
+size_t boat_env_observation_size(const BoatEnvConfig *config);
+
+/* observation must stay valid and 8 bytes aligned until boat_env_destroy.
+   The same seed and the same actions always give the same games */
+BoatEnv *boat_env_create(uint64_t seed, const BoatEnvConfig *config, void *observation, size_t observationSize);
+void boat_env_destroy(BoatEnv *env);
+
+/* Advances one fixed step, returns the event or -1 on error. Once done, steps do nothing until reset */
+int boat_env_step(BoatEnv *env, int action);
+
+/* Starts a new episode */
+int boat_env_reset(BoatEnv *env);
+
+/* Also publishes every observation, from now on, to a shared memory ring of slotCount slots */
+int boat_env_publish(BoatEnv *env, const char *ringName, int slotCount);
+
+/* Consumer side of a ring created by boat_env_publish */
+BoatEnvRing *boat_env_ring_open(const char *ringName);
+void boat_env_ring_close(BoatEnvRing *ring);
+
+/* Bytes of an observation in the ring */
+size_t boat_env_ring_observation_size(const BoatEnvRing *ring);
+
+/* Observations published so far: the latest one has index count - 1 */
+uint64_t boat_env_ring_count(const BoatEnvRing *ring);
+
+/* Copies observation index into out. Returns 0 on success, 1 if it is not published yet
+   or was already overwritten by a newer one, -1 on error */
+int boat_env_ring_read(BoatEnvRing *ring, uint64_t index, void *out, size_t outSize);
+
+static inline const float *boat_env_rock_column(const BoatEnvObservation *observation, int column)
+{
+    return (const float *)(observation + 1) + (size_t)column * observation->rockCount;
+}
+
+static inline const int32_t *boat_env_rock_kinds(const BoatEnvObservation *observation)
+{
+    return (const int32_t *)boat_env_rock_column(observation, BOAT_ENV_ROCK_COLUMNS);
+}
+
+#ifdef __cplusplus
+}
+#endif
+
+#endif
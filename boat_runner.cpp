@@ -1,5 +1,14 @@
 #include "boat_runner.hpp"
 #include "collision_box.hpp"
+#include "game_core.hpp"
+#include "batch_runner.hpp"
+#include "input_log.hpp"
+#include "input_queue.hpp"
+#include "triple_buffer.hpp"
+#include "autopilot.hpp"
+#include "allocation_counter.hpp"
+#include "entity_store.hpp"
+#include "shared_course.hpp"
 
 const int WINDOW_WIDTH = 1000;
 const int WINDOW_HEIGHT = 800;
@@ -7,6 +16,7 @@ const int WINDOW_HEIGHT = 800;
 const std::string WINDOW_TITLE = "Boat Runner";
 
 const std::string VERT_SHADER_PATH = "shaders/vert.spv";
+const std::string INSTANCED_VERT_SHADER_PATH = "shaders/instancedVert.spv";
 const std::string FRAG_SHADER_PATH = "shaders/frag.spv";
 
 const std::string SKYBOX_VERT_SHADER_PATH = "shaders/skyboxVert.spv";
@@ -44,42 +54,43 @@ const std::string SKYBOX_TEXTURES_PATH[] = {"textures/sky/bkg1_right.png",
                                             "textures/sky/bkg1_front.png",
                                             "textures/sky/bkg1_back.png"};
 
-const int ROCK1_NUMBER = 6;
-const int ROCK2_NUMBER = 6;
-
 const float NEAR_PLANE = 0.1f;
 const float FAR_PLANE = 40.0f;
 
-const float MIN_X = -35.0f;
-const float SPAWN_LIMIT_X = -20.0f;
-const float MAX_X = 3.25f;
+// Rock models, each one drawn by its own archetype
+const int ROCK_KINDS = 2;
 
-const float MIN_Z = -10.0f;
-const float MAX_Z = 10.0f;
+const long HEADLESS_DEFAULT_STEPS = 1000000;
 
-const float HORIZONTAL_SPEED = 1.8f;
-const float VERTICAL_SPEED = 5.0f;
-const float VERTICAL_SPEED_INCREMENT = 0.05f;
+// Stress runs: rock fields from STRESS_MIN_ROCKS, growing tenfold up to the requested size
+const long STRESS_DEFAULT_STEPS = 2400;
+const int STRESS_DEFAULT_ROCKS = 100000;
+const int STRESS_MIN_ROCKS = 1000;
 
-const float OCEAN_SPEED = 0.6f;
-const float OCEAN_SPEED_INCREMENT = 0.0025f;
-const glm::vec3 OCEAN_INIT_POS = glm::vec3(-30.0f, -0.13f, -24.0f);
+// Simulation steps per frame handed to the renderer in the stress runs, as at 60 fps
+const int STRESS_FRAME_STEPS = 4;
 
-const int MAX_POSITION_GENERATION = 10;
-const float MIN_ROCK_DISTANCE = 0.7f;
+// Steps each boat of a --boats run holds a random direction
+const int SHARED_COURSE_STEER_STEPS = 24;
 
-const int WIN_POINTS = 200;
+// Frames allowed to allocate while everything gets set up, when counting allocations
+const long ALLOCATION_WARMUP_FRAMES = 120;
 
 const glm::vec3 WIN_TEXT_POSITION = glm::vec3(-0.475, -0.5, 0);
 const glm::vec3 LOSE_TEXT_POSITION = glm::vec3(-0.45, -0.5, 0);
 const glm::vec3 RESTART_TEXT_POSITION = glm::vec3(-0.35, -0.2, 0);
 const glm::vec3 OUT_TEXT_POSITION = glm::vec3(-2, -2, 0);
 
-struct Game
+// State published by the simulation thread for the render thread
+struct SimFrame
 {
-    bool started = false;
-    int points = 0;
-    int highscore = 0;
+    // Clock time the state was simulated up to
+    double time = 0.0;
+
+    // How the last game ended, while waiting for a restart
+    GameEvent outcome = Playing;
+
+    GameSnapshot snapshot;
 };
 
 struct UniformBufferObject
@@ -96,13 +107,106 @@ struct SkyBoxUniformBufferObject
     alignas(16) glm::mat4 nMat;
 };
 
+// Rocks of each kind for a field of total rocks, split between the kinds like the default one
+std::vector<int> getRockCounts(int total)
+{
+    if (total <= 0)
+    {
+        return {ROCK1_NUMBER, ROCK2_NUMBER};
+    }
+
+    return {total - total / 2, total / 2};
+}
+
+// Model matrices of the rocks of a frame into the instances of each kind, interpolated alpha
+// of the way between the last two steps. Rocks of the same kind are interchangeable:
+// the instances of a kind take the rocks of that kind in slot order
+void writeRockMatrices(const GameSnapshot &snapshot, float alpha, Instance *const instances[ROCK_KINDS])
+{
+    // Rock columns as laid out in the RockField
+    const int capacity = snapshot.rockColumns.size() / ROCK_COLUMNS;
+    const float *columns = snapshot.rockColumns.data();
+    const float *x = columns + ColumnX * capacity;
+    const float *z = columns + ColumnZ * capacity;
+    const float *previousX = columns + ColumnPreviousX * capacity;
+    const float *previousZ = columns + ColumnPreviousZ * capacity;
+    const float *scale = columns + ColumnScale * capacity;
+
+    Instance *next[ROCK_KINDS];
+    std::copy(instances, instances + ROCK_KINDS, next);
+
+    for (int i = 0; i < snapshot.rockCount; ++i)
+    {
+        glm::mat4 &model = (next[snapshot.rockKinds[i]]++)->model;
+        model = glm::mat4(scale[i]);
+        model[3] = glm::vec4(glm::mix(previousX[i], x[i], alpha),
+                             ROCK_Y,
+                             glm::mix(previousZ[i], z[i], alpha),
+                             1.0f);
+    }
+}
+
 class BoatRunner : public BaseProject
 {
+public:
+    BoatRunner(uint64_t seed, int rocks = 0, const std::string &recordFile = "", bool autopilot = false, int threads = 1)
+        : seed(seed), rocks(rocks), recordFile(recordFile), autopilotEnabled(autopilot), pool(threads){};
+
+    ~BoatRunner()
+    {
+        stopSimulation();
+    }
+
+    // Writes the inputs recorded so far, if recording
+    void saveRecording()
+    {
+        if (recorder.isStarted())
+        {
+            recorder.save(recordFile);
+            logInfo("Recorded ", recorder.getSteps(), " steps to ", recordFile);
+        }
+    }
+
 protected:
-    Game game;
+    uint64_t seed;
+
+    // Rocks in the field, 0 for the default field
+    int rocks;
+
+    std::string recordFile;
+    InputRecorder recorder;
+
+    // Simulation thread: everything here but simFrames is only touched by it once started
+    std::thread simThread;
+    std::atomic<bool> simRunning{false};
+
+    CourseStream courseStream;
+    GameCore core;
+    FixedTimestep timestep;
+    GameEvent outcome = Playing;
+
+    // Steers instead of the keyboard and restarts lost games right away, for soak runs
+    bool autopilotEnabled;
+    ThreadPool pool;
+    Autopilot autopilot;
+
+    // Key events, from the GLFW callbacks to the simulation
+    InputQueue inputQueue;
+    InputState input;
+
+    // Snapshots of the game, from the simulation to the render thread
+    TripleBuffer<SimFrame> simFrames;
+
+    // Clock time of the current frame
+    double frameTime = 0.0;
+
+    // Per frame allocation check, only active when counting allocations
+    long frames = 0;
+    unsigned long lastAllocationCount = 0;
 
     DescriptorSetLayout descSetLayout;
     Pipeline pipeline;
+    Pipeline instancedPipeline;
 
     DescriptorSetLayout textDescSetLayout;
     Pipeline textPipeline;
@@ -111,9 +215,21 @@ protected:
     Pipeline skyboxPipeline;
     SkyBoxModel skybox = {SKYBOX_MODEL_PATH, std::vector<std::string>(std::begin(SKYBOX_TEXTURES_PATH), std::end(SKYBOX_TEXTURES_PATH))};
 
+    // Meshes and textures, drawn by the archetypes that refer to them
     std::vector<Object> objects = {};
     std::vector<Text> texts = {};
 
+    // Rendered entities, and the descriptor set of each one, indexed by render handle
+    EntityStore entities;
+    std::vector<DescriptorSet> entitySets;
+
+    // Model matrices of the rocks of each kind, drawn instanced
+    InstanceBuffer rockInstances[ROCK_KINDS];
+
+    int boatArchetype = -1;
+    int rockArchetypes[ROCK_KINDS] = {};
+    int oceanArchetype = -1;
+
     void setWindowParameters()
     {
         windowWidth = WINDOW_WIDTH;
@@ -122,47 +238,46 @@ protected:
         initialBackgroundColor = {0.0f, 0.0f, 0.0f, 1.0f};
     }
 
-    // Setups objects instances
+    // Setups the entities, their positions are taken from the game core once the models are loaded
     void setupObjects()
     {
-        glm::vec3 generatedPosition;
-        float generatedScale;
+        const unsigned rendered = TransformComponent | RenderComponent;
+        const unsigned instanced = RenderComponent | InstancedComponent;
+        const std::vector<int> rockCounts = getRockCounts(rocks);
 
         // Boat
-        Object boat = {BOAT_MODEL_PATH, BOAT_TEXTURE_PATH, 0.0012f};
+        Object boat = {BOAT_MODEL_PATH, BOAT_TEXTURE_PATH, BOAT_DEFAULT_SCALE};
         objects.push_back(boat);
 
-        ObjectInstance boatInstance = {Boat, glm::vec3(2.5f, -0.1f, 0.0f), glm::vec3(0), glm::vec3(boat.defaultScale)};
-        objects.back().instances.push_back(boatInstance);
+        boatArchetype = entities.addArchetype(rendered, objects.size() - 1);
+        entities.addEntity(boatArchetype, {BOAT_INIT_POS, glm::vec3(0), glm::vec3(boat.defaultScale)});
 
         // Rock1
-        Object rock1 = {ROCK1_MODEL_PATH, ROCK1_TEXTURE_PATH, 0.15f};
+        Object rock1 = {ROCK1_MODEL_PATH, ROCK1_TEXTURE_PATH, ROCK1_DEFAULT_SCALE};
         objects.push_back(rock1);
 
-        for (int i = 0; i < ROCK1_NUMBER; ++i)
+        rockArchetypes[0] = entities.addArchetype(instanced, objects.size() - 1);
+        for (int i = 0; i < rockCounts[0]; ++i)
         {
-            std::tie(generatedPosition, generatedScale) = generateRandomRockSpawn(rock1);
-            ObjectInstance rockInstance = {Rock, generatedPosition, glm::vec3(0), glm::vec3(generatedScale)};
-            objects.back().instances.push_back(rockInstance);
+            entities.addEntity(rockArchetypes[0], {});
         }
 
         // Rock2
-        Object rock2 = {ROCK2_MODEL_PATH, ROCK2_TEXTURE_PATH, 0.25f};
+        Object rock2 = {ROCK2_MODEL_PATH, ROCK2_TEXTURE_PATH, ROCK2_DEFAULT_SCALE};
         objects.push_back(rock2);
 
-        for (int i = 0; i < ROCK2_NUMBER; ++i)
+        rockArchetypes[1] = entities.addArchetype(instanced, objects.size() - 1);
+        for (int i = 0; i < rockCounts[1]; ++i)
         {
-            std::tie(generatedPosition, generatedScale) = generateRandomRockSpawn(rock2);
-            ObjectInstance rockInstance = {Rock, generatedPosition, glm::vec3(0), glm::vec3(generatedScale)};
-            objects.back().instances.push_back(rockInstance);
+            entities.addEntity(rockArchetypes[1], {});
         }
 
         // Ocean
         Object ocean = {OCEAN_MODEL_PATH, OCEAN_TEXTURE_PATH, 37.0f};
         objects.push_back(ocean);
 
-        ObjectInstance oceanInstance = {Ocean, glm::vec3(-30.0f, -0.13f, -24.0f), glm::vec3(0), glm::vec3(ocean.defaultScale, 3.0, ocean.defaultScale)}; // to avoid to sink, use 5.0 instead of 8.0
-        objects.back().instances.push_back(oceanInstance);
+        oceanArchetype = entities.addArchetype(rendered, objects.size() - 1);
+        entities.addEntity(oceanArchetype, {OCEAN_INIT_POS, glm::vec3(0), glm::vec3(ocean.defaultScale, 3.0, ocean.defaultScale)}); // to avoid to sink, use 5.0 instead of 8.0
 
         // Text
         Text winText = {WIN_MODEL_PATH, WIN_TEXTURE_PATH, OUT_TEXT_POSITION, glm::vec3(0), glm::vec3(0.2, 0.3, 0)};
@@ -174,15 +289,10 @@ protected:
         Text restartText = {RESTART_MODEL_PATH, RESTART_TEXTURE_PATH, OUT_TEXT_POSITION, glm::vec3(0), glm::vec3(0.08, 0.12, 0)};
         texts.push_back(restartText);
 
-        int i = 0;
-        for (const auto obj : objects)
-        {
-            i += obj.instances.size();
-        }
-
-        i += texts.size();
+        int i = entities.renderCount() + texts.size();
 
-        // Descriptor pool sizes
+        // Descriptor pool sizes: one set per render handle, so the rocks take one per kind
+        // whatever their number
         uniformBlocksInPool = i + 1;
         texturesInPool = i + 1;
         setsInPool = i + 1;
@@ -191,9 +301,6 @@ protected:
     // Here you load and setup all your Vulkan objects
     void localInit()
     {
-        // Set random seed
-        srand(time(NULL));
-
         // Descriptor Layouts
         descSetLayout.init(this, {{0, VK_DESCRIPTOR_TYPE_UNIFORM_BUFFER, VK_SHADER_STAGE_VERTEX_BIT},
                                   {1, VK_DESCRIPTOR_TYPE_COMBINED_IMAGE_SAMPLER, VK_SHADER_STAGE_FRAGMENT_BIT}});
@@ -206,6 +313,7 @@ protected:
 
         // Pipelines
         pipeline.init(this, VERT_SHADER_PATH, FRAG_SHADER_PATH, {&descSetLayout}, VK_COMPARE_OP_LESS, VK_CULL_MODE_BACK_BIT);
+        instancedPipeline.init(this, INSTANCED_VERT_SHADER_PATH, FRAG_SHADER_PATH, {&descSetLayout}, VK_COMPARE_OP_LESS, VK_CULL_MODE_BACK_BIT, true);
         skyboxPipeline.init(this, SKYBOX_VERT_SHADER_PATH, SKYBOX_FRAG_SHADER_PATH, {&skyboxDescSetLayout}, VK_COMPARE_OP_LESS_OR_EQUAL, VK_CULL_MODE_BACK_BIT);
         textPipeline.init(this, TEXT_VERT_SHADER_PATH, TEXT_FRAG_SHADER_PATH, {&textDescSetLayout}, VK_COMPARE_OP_LESS, VK_CULL_MODE_NONE);
 
@@ -213,11 +321,20 @@ protected:
         for (auto &obj : objects)
         {
             obj.init(this);
+        }
 
-            for (auto &inst : obj.instances)
-            {
-                inst.init(this, &descSetLayout, {{0, UNIFORM, sizeof(UniformBufferObject), nullptr, nullptr}, {1, TEXTURE, 0, &obj.texture, nullptr}});
-            }
+        entitySets.resize(entities.renderCount());
+        entities.forEach(RenderComponent, [&](const Archetype &archetype)
+                         {
+                             for (int handle : archetype.renderHandles)
+                             {
+                                 entitySets[handle].init(this, &descSetLayout, {{0, UNIFORM, sizeof(UniformBufferObject), nullptr, nullptr}, {1, TEXTURE, 0, &objects[archetype.mesh].texture, nullptr}});
+                             }
+                         });
+
+        for (int kind = 0; kind < ROCK_KINDS; ++kind)
+        {
+            rockInstances[kind].init(this, entities.get(rockArchetypes[kind]).count);
         }
 
         for (auto &text : texts)
@@ -227,13 +344,52 @@ protected:
 
         skybox.init(this, &skyboxDescSetLayout, {{0, UNIFORM, sizeof(SkyBoxUniformBufferObject), nullptr, nullptr}, {1, SKYBOX, 0, nullptr, &skybox.texture}});
 
-        game.started = true;
+        // Game logic, now that the model boundaries are known
+        core.courseStream = &courseStream;
+        core.init(seed,
+                  objects[0].model.boundaries,
+                  {{objects[1].defaultScale, objects[1].model.boundaries, objects[1].model.hull},
+                   {objects[2].defaultScale, objects[2].model.boundaries, objects[2].model.hull}},
+                  getRockCounts(rocks),
+                  objects[0].model.hull);
+
+        if (!recordFile.empty())
+        {
+            recorder.start(seed, rocks);
+        }
+
+        if (autopilotEnabled)
+        {
+            autopilot.init(core, &pool);
+        }
+
+        publishFrame(inputClock());
+        syncObjectsFromFrame(simFrames.read(), 1.0f);
+
+        glfwSetWindowUserPointer(window, this);
+        glfwSetKeyCallback(window, keyCallback);
+
+        simRunning.store(true, std::memory_order_release);
+        simThread = std::thread([this]
+                                { simulate(); });
     }
 
     // Here you destroy all the objects you created!
     void localCleanup()
     {
+        stopSimulation();
+
         // Objects
+        for (auto &set : entitySets)
+        {
+            set.cleanup();
+        }
+
+        for (auto &instances : rockInstances)
+        {
+            instances.cleanup();
+        }
+
         for (auto &obj : objects)
         {
             obj.cleanup();
@@ -248,6 +404,7 @@ protected:
 
         // Pipelines
         pipeline.cleanup();
+        instancedPipeline.cleanup();
         textPipeline.cleanup();
         skyboxPipeline.cleanup();
 
@@ -264,30 +421,59 @@ protected:
     {
         vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, pipeline.graphicsPipeline);
 
-        for (const auto &obj : objects)
+        entities.forEach(RenderComponent, [&](const Archetype &archetype)
+                         {
+                             if (archetype.has(InstancedComponent))
+                             {
+                                 return;
+                             }
+
+                             const Object &obj = objects[archetype.mesh];
+                             VkBuffer vertexBuffers[] = {obj.model.vertexBuffer};
+
+                             // property .vertexBuffer of models, contains the VkBuffer handle to its vertex buffer
+                             VkDeviceSize offsets[] = {0};
+                             vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+
+                             // property .indexBuffer of models, contains the VkBuffer handle to its index buffer
+                             vkCmdBindIndexBuffer(commandBuffer, obj.model.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
+
+                             for (int handle : archetype.renderHandles)
+                             {
+                                 // property .pipelineLayout of a pipeline contains its layout.
+                                 // property .descriptorSets of a descriptor set contains its elements.
+                                 vkCmdBindDescriptorSets(commandBuffer,
+                                                         VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                                         pipeline.pipelineLayout, 0, 1, &entitySets[handle].descriptorSets[currentImage],
+                                                         0, nullptr);
+
+                                 // property .indices.size() of models, contains the number of triangles * 3 of the mesh.
+                                 vkCmdDrawIndexed(commandBuffer,
+                                                  static_cast<uint32_t>(obj.model.indices.size()), 1, 0, 0, 0);
+                             }
+                         });
+
+        // Rocks, one instanced draw per kind reading the model matrices from its instance buffer
+        vkCmdBindPipeline(commandBuffer, VK_PIPELINE_BIND_POINT_GRAPHICS, instancedPipeline.graphicsPipeline);
+
+        for (int kind = 0; kind < ROCK_KINDS; ++kind)
         {
-            VkBuffer vertexBuffers[] = {obj.model.vertexBuffer};
+            const Archetype &archetype = entities.get(rockArchetypes[kind]);
+            const Object &obj = objects[archetype.mesh];
 
-            // property .vertexBuffer of models, contains the VkBuffer handle to its vertex buffer
-            VkDeviceSize offsets[] = {0};
-            vkCmdBindVertexBuffers(commandBuffer, 0, 1, vertexBuffers, offsets);
+            VkBuffer vertexBuffers[] = {obj.model.vertexBuffer, rockInstances[kind].buffers[currentImage]};
+            VkDeviceSize offsets[] = {0, 0};
+            vkCmdBindVertexBuffers(commandBuffer, 0, 2, vertexBuffers, offsets);
 
-            // property .indexBuffer of models, contains the VkBuffer handle to its index buffer
             vkCmdBindIndexBuffer(commandBuffer, obj.model.indexBuffer, 0, VK_INDEX_TYPE_UINT32);
 
-            for (const auto &inst : obj.instances)
-            {
-                // property .pipelineLayout of a pipeline contains its layout.
-                // property .descriptorSets of a descriptor set contains its elements.
-                vkCmdBindDescriptorSets(commandBuffer,
-                                        VK_PIPELINE_BIND_POINT_GRAPHICS,
-                                        pipeline.pipelineLayout, 0, 1, &inst.descSet.descriptorSets[currentImage],
-                                        0, nullptr);
-
-                // property .indices.size() of models, contains the number of triangles * 3 of the mesh.
-                vkCmdDrawIndexed(commandBuffer,
-                                 static_cast<uint32_t>(obj.model.indices.size()), 1, 0, 0, 0);
-            }
+            vkCmdBindDescriptorSets(commandBuffer,
+                                    VK_PIPELINE_BIND_POINT_GRAPHICS,
+                                    instancedPipeline.pipelineLayout, 0, 1, &entitySets[archetype.renderHandles[0]].descriptorSets[currentImage],
+                                    0, nullptr);
+
+            vkCmdDrawIndexed(commandBuffer,
+                             static_cast<uint32_t>(obj.model.indices.size()), static_cast<uint32_t>(archetype.count), 0, 0, 0);
         }
 
         // Text
@@ -332,265 +518,223 @@ protected:
                          static_cast<uint32_t>(skybox.box.indices.size()), 1, 0, 0, 0);
     }
 
-    // Generates random float between min and max
-    float getRandFloat(float min, float max)
+    // Runs on the event thread, inside glfwPollEvents: stamps the key events the game
+    // reacts to and queues them for the simulation, which applies them at their own time
+    static void keyCallback(GLFWwindow *window, int key, int scancode, int action, int mods)
     {
-        return min + (rand() / (RAND_MAX / (max - min)));
-    }
+        if (action == GLFW_REPEAT)
+        {
+            return;
+        }
 
-    // Generates a random rock position
-    glm::vec3 generateRandomRockCoord(bool respawn = false)
-    {
-        if (respawn)
+        InputKey inputKey;
+        if (key == GLFW_KEY_A || key == GLFW_KEY_LEFT)
+        {
+            inputKey = KeySteerLeft;
+        }
+        else if (key == GLFW_KEY_D || key == GLFW_KEY_RIGHT)
+        {
+            inputKey = KeySteerRight;
+        }
+        else if (key == GLFW_KEY_SPACE)
         {
-            return glm::vec3(MIN_X,
-                             -0.4f,
-                             getRandFloat(MIN_Z, MAX_Z));
+            inputKey = KeyRestart;
         }
         else
         {
-            return glm::vec3(getRandFloat(MIN_X, SPAWN_LIMIT_X),
-                             -0.4f,
-                             getRandFloat(MIN_Z, MAX_Z));
+            return;
+        }
+
+        auto app = reinterpret_cast<BoatRunner *>(glfwGetWindowUserPointer(window));
+        if (!app->inputQueue.push({inputClock(), inputKey, action == GLFW_PRESS}))
+        {
+            logWarning("Input queue full, key event dropped");
         }
     }
 
-    // Generates position and scale for rock
-    std::tuple<glm::vec3, float> generateRandomRockSpawn(Object rock, bool respawn = false)
+    // Counts the heap allocations made since the previous frame. Once warmed up, a frame that
+    // allocates fails the run, so that allocations in the steady state loop are caught right away
+    void checkFrameAllocations()
     {
-        bool invalidPosition;
-        glm::vec3 position;
-        float scale;
-        int generation = 0;
+        unsigned long count = allocationCount();
+        unsigned long allocations = count - lastAllocationCount;
+        lastAllocationCount = count;
 
-        do
+        if (!ALLOCATION_COUNTING || ++frames <= ALLOCATION_WARMUP_FRAMES || allocations == 0)
         {
-            invalidPosition = false;
-            position = generateRandomRockCoord(respawn);
-            float scaleLimits = rock.defaultScale * 0.4f;
-            scale = getRandFloat(rock.defaultScale - scaleLimits, rock.defaultScale + scaleLimits);
+            return;
+        }
 
-            float minX = rock.model.boundaries.minX * scale;
-            float maxX = rock.model.boundaries.maxX * scale;
+        logError("Frame ", frames, ": ", allocations, " heap allocations");
 
-            float minZ = rock.model.boundaries.minZ * scale;
-            float maxZ = rock.model.boundaries.maxZ * scale;
+        throw std::runtime_error("heap allocation in the steady state loop");
+    }
 
-            CollisionBox newRockBox = CollisionBox(position, minX, maxX, minZ, maxZ);
+    // Runs the game on its own thread, in real time, so that waiting on the GPU never holds it up:
+    // it wakes up every SIM_STEP, simulates the steps due and publishes the resulting state
+    void simulate()
+    {
+        double lastTime = inputClock();
+
+        while (simRunning.load(std::memory_order_acquire))
+        {
+            double now = inputClock();
+            double delta = now - lastTime;
+            lastTime = now;
 
-            for (const auto &obj : objects)
+            // Clock time the game is simulated up to, the rest is left for the next round
+            double simTime = now;
+
+            if (core.game.started)
             {
-                for (const auto &inst : obj.instances)
+                int steps = timestep.advance(delta);
+                simTime = now - timestep.accumulator;
+
+                for (int i = 0; i < steps; ++i)
                 {
-                    if (inst.type == Rock)
+                    // Keys pressed before the step starts steer it
+                    input.applyUntil(inputQueue, simTime - (steps - i) * SIM_STEP);
+                    int horDir = autopilotEnabled ? autopilot.steer(core) : input.horizontalDirection();
+
+                    GameEvent event = core.step(SIM_STEP, horDir);
+
+                    if (recorder.isStarted())
+                    {
+                        recorder.step(horDir, core.stateHash());
+                    }
+
+                    if (event != Playing)
                     {
-                        CollisionBox rockBox = getCollisionBoxFromInstance(obj, inst);
-                        if (newRockBox.checkCollision(rockBox) || glm::length(position - inst.position) < MIN_ROCK_DISTANCE)
-                        {
-                            invalidPosition = true;
-                        }
+                        endGame(event == Win);
+                        timestep.reset();
+                        simTime = now;
+                        break;
                     }
                 }
             }
+            else
+            {
+                waitRestart(now);
+            }
 
-            generation++;
-
-        } while (invalidPosition && generation < MAX_POSITION_GENERATION);
+            publishFrame(simTime);
 
-        return std::make_tuple(position, scale);
+            std::this_thread::sleep_for(std::chrono::duration<double>(simTime + SIM_STEP - inputClock()));
+        }
     }
 
-    int getHorizontalDirection()
+    void stopSimulation()
     {
-        if (glfwGetKey(window, GLFW_KEY_A) || glfwGetKey(window, GLFW_KEY_LEFT))
+        if (simThread.joinable())
         {
-            return -1;
-        }
-        else if (glfwGetKey(window, GLFW_KEY_D) || glfwGetKey(window, GLFW_KEY_RIGHT))
-        {
-            return 1;
-        }
-        else
-        {
-            return 0;
+            simRunning.store(false, std::memory_order_release);
+            simThread.join();
         }
     }
 
-    double getDeltaTime()
+    // Copies the game into the free frame and hands it to the render thread
+    void publishFrame(double time)
     {
-        static auto lastTime = std::chrono::high_resolution_clock::now();
-
-        auto currentTime = std::chrono::high_resolution_clock::now();
+        SimFrame &frame = simFrames.writeSlot();
 
-        double delta = std::chrono::duration<double>(currentTime - lastTime).count();
-        lastTime = currentTime;
+        core.saveSnapshot(frame.snapshot);
+        frame.time = time;
+        frame.outcome = outcome;
 
-        return delta;
+        simFrames.publish();
     }
 
-    void updateObjectsPositions(double delta, int horDir)
+    // Copies a simulated state into the transforms of the entities and texts that get rendered,
+    // interpolating alpha of the way between its last two steps.
+    // The rocks have no transforms, their instances are written by writeRockMatrices
+    void syncObjectsFromFrame(const SimFrame &frame, float alpha)
     {
-        int pointsGained = 0;
-        for (auto &obj : objects)
-        {
-            for (auto &inst : obj.instances)
-            {
-                if (inst.type == Boat)
-                {
-                    inst.rotation.y = 0.0f - horDir * 20.0f;
-                }
-                else if (inst.type == Rock)
-                {
-                    inst.position.x += (VERTICAL_SPEED + VERTICAL_SPEED_INCREMENT * game.points) * delta;
-                    inst.position.z += horDir * HORIZONTAL_SPEED * delta;
+        const GameCoreState &state = frame.snapshot.state;
 
-                    // Respawn
-                    if (inst.position.x > MAX_X)
-                    {
-                        float scale;
-                        std::tie(inst.position, scale) = generateRandomRockSpawn(obj, true);
-                        inst.scale = glm::vec3(scale);
-                        pointsGained++;
-
-                        if (game.points + pointsGained >= WIN_POINTS)
-                        {
-                            game.points += pointsGained;
-                            endGame(true);
-                        }
-                    }
-                }
+        Transform &boat = entities.get(boatArchetype).transforms[0];
+        boat.position = core.boatPosition;
+        boat.rotation = glm::mix(state.previousBoatRotation, state.boatRotation, alpha);
 
-                else if (inst.type == Ocean)
-                {
-                    inst.position.x += (OCEAN_SPEED + OCEAN_SPEED_INCREMENT) * delta;
-                    inst.position.z += (OCEAN_SPEED + OCEAN_SPEED_INCREMENT) * delta;
-                }
-            }
-        }
+        entities.get(oceanArchetype).transforms[0].position = glm::mix(state.previousOceanPosition, state.oceanPosition, alpha);
 
-        game.points += pointsGained;
-    }
+        for (auto &text : texts)
+        {
+            text.position = OUT_TEXT_POSITION;
+        }
 
-    void waitRestart()
-    {
-        if (glfwGetKey(window, GLFW_KEY_SPACE))
+        if (!state.game.started)
         {
-            for (auto &obj : objects)
+            if (frame.outcome == Win)
             {
-                for (auto &inst : obj.instances)
-                {
-                    if (inst.type == Boat)
-                    {
-                        inst.rotation = glm::vec3(0.0f, 0.0f, 0.0f);
-                    }
-                    else if (inst.type == Rock)
-                    {
-                        float scale;
-                        std::tie(inst.position, scale) = generateRandomRockSpawn(obj);
-                        inst.scale = glm::vec3(scale);
-                    }
-                    else if (inst.type == Ocean)
-                    {
-                        inst.position = OCEAN_INIT_POS;
-                    }
-                }
+                texts[0].position = WIN_TEXT_POSITION;
             }
-            game.points = 0;
-            game.started = true;
-
-            for (auto &text : texts)
+            else
             {
-                text.position = OUT_TEXT_POSITION;
+                texts[1].position = LOSE_TEXT_POSITION;
             }
-        }
-    }
 
-    CollisionBox getCollisionBoxFromInstance(const Object &object, const ObjectInstance &instance)
-    {
-        glm::vec2 position = glm::vec2(instance.position.x, instance.position.z);
-        float scale = instance.scale.x;
-
-        float minX = object.model.boundaries.minX * scale;
-        float maxX = object.model.boundaries.maxX * scale;
-
-        float minZ = object.model.boundaries.minZ * scale;
-        float maxZ = object.model.boundaries.maxZ * scale;
-
-        return CollisionBox(position, minX, maxX, minZ, maxZ);
+            texts[2].position = RESTART_TEXT_POSITION;
+        }
     }
 
-    void checkCollision()
+    void waitRestart(double now)
     {
-        CollisionBox boatBox = getCollisionBoxFromInstance(objects[0], objects[0].instances[0]);
+        input.applyUntil(inputQueue, now);
 
-        for (const auto &obj : objects)
+        if (autopilotEnabled || input.isHeld(KeyRestart))
         {
-            for (const auto &inst : obj.instances)
-            {
-                if (inst.type == Rock)
-                {
-                    CollisionBox rockBox = getCollisionBoxFromInstance(obj, inst);
+            core.restart();
+            timestep.reset();
+            autopilot.reset();
+            outcome = Playing;
 
-                    if (boatBox.checkCollision(rockBox))
-                    {
-                        endGame(false);
-                    }
-                }
+            if (recorder.isStarted())
+            {
+                recorder.restart();
             }
         }
     }
 
     void endGame(bool win)
     {
-        game.highscore = std::max(game.highscore, game.points);
-
-        std::string message;
+        outcome = win ? Win : Lose;
 
+        // Logged, so that ending a game neither allocates nor waits on the terminal
+        logInfo("");
+        logInfo("==================================");
+        logInfo("");
         if (win)
         {
-            message = "You win! You reached " + std::to_string(WIN_POINTS) + " points!";
-            texts[0].position = WIN_TEXT_POSITION;
+            logInfo("You win! You reached ", WIN_POINTS, " points!");
         }
         else
         {
-            message = "You lose! You hit a rock!";
-            texts[1].position = LOSE_TEXT_POSITION;
+            logInfo("You lose! You hit a rock!");
         }
-
-        texts[2].position = RESTART_TEXT_POSITION;
-
-        std::cout << std::endl
-                  << "==================================" << std::endl
-                  << std::endl;
-        std::cout << message << std::endl;
-        std::cout << "Points: " << game.points << std::endl;
-        std::cout << "Highscore: " << game.highscore << std::endl;
-        std::cout << "Press SPACEBAR to restart" << std::endl;
-        std::cout << std::endl
-                  << "==================================" << std::endl
-                  << std::endl;
-
-        game.started = false;
+        logInfo("Points: ", core.game.points);
+        logInfo("Highscore: ", core.game.highscore);
+        logInfo("Press SPACEBAR to restart");
+        logInfo("");
+        logInfo("==================================");
+        logInfo("");
     }
 
     // Here is where you update the uniforms.
     // Very likely this will be where you will be writing the logic of your application.
     void updateUniformBuffer(uint32_t currentImage)
     {
-        double delta = getDeltaTime();
-        static int horDir = 0;
+        checkFrameAllocations();
+
+        // Picks up the keys pressed while drawFrame waited on the fences
+        glfwPollEvents();
+
+        frameTime = inputClock();
         void *data;
 
-        if (game.started)
-        {
-            horDir = getHorizontalDirection();
-            updateObjectsPositions(delta, horDir);
-            checkCollision();
-        }
-        else
-        {
-            waitRestart();
-        }
+        // Latest state from the simulation thread, shown one step behind so that it can be interpolated
+        const SimFrame &frame = simFrames.read();
+        const float alpha = glm::clamp(static_cast<float>((frameTime - frame.time) / SIM_STEP), 0.0f, 1.0f);
+        syncObjectsFromFrame(frame, alpha);
 
         float aspectRatio = (float)swapChainExtent.width / (float)swapChainExtent.height;
 
@@ -603,24 +747,46 @@ protected:
                                                 NEAR_PLANE, FAR_PLANE);
         projMatrix[1][1] *= -1;
 
-        for (const auto &obj : objects)
+        entities.forEach(TransformComponent | RenderComponent, [&](const Archetype &archetype)
+                         {
+                             for (int i = 0; i < archetype.count; ++i)
+                             {
+                                 const Transform &transform = archetype.transforms[i];
+                                 const DescriptorSet &set = entitySets[archetype.renderHandles[i]];
+
+                                 UniformBufferObject ubo{};
+                                 ubo.model = glm::translate(glm::mat4(1.0f), transform.position) *
+                                             glm::rotate(glm::mat4(1.0), glm::radians(transform.rotation.y), glm::vec3(0, 1, 0)) *
+                                             glm::rotate(glm::mat4(1.0), glm::radians(transform.rotation.x), glm::vec3(1, 0, 0)) *
+                                             glm::rotate(glm::mat4(1.0), glm::radians(transform.rotation.z), glm::vec3(0, 0, 1)) *
+                                             glm::scale(glm::mat4(1.0), transform.scale);
+                                 ubo.view = camMatrix;
+                                 ubo.proj = projMatrix;
+
+                                 vkMapMemory(device, set.uniformBuffersMemory[0][currentImage], 0, sizeof(ubo), 0, &data);
+                                 memcpy(data, &ubo, sizeof(ubo));
+                                 vkUnmapMemory(device, set.uniformBuffersMemory[0][currentImage]);
+                             }
+                         });
+
+        // Rocks: the model matrices are per instance, the uniforms of each kind only carry the camera
+        Instance *instances[ROCK_KINDS];
+        for (int kind = 0; kind < ROCK_KINDS; ++kind)
         {
-            for (const auto &inst : obj.instances)
-            {
-                UniformBufferObject ubo{};
-                ubo.model = glm::translate(glm::mat4(1.0f), inst.position) *
-                            glm::rotate(glm::mat4(1.0), glm::radians(inst.rotation.y), glm::vec3(0, 1, 0)) *
-                            glm::rotate(glm::mat4(1.0), glm::radians(inst.rotation.x), glm::vec3(1, 0, 0)) *
-                            glm::rotate(glm::mat4(1.0), glm::radians(inst.rotation.z), glm::vec3(0, 0, 1)) *
-                            glm::scale(glm::mat4(1.0), inst.scale);
-                ubo.view = camMatrix;
-                ubo.proj = projMatrix;
-
-                vkMapMemory(device, inst.descSet.uniformBuffersMemory[0][currentImage], 0, sizeof(ubo), 0, &data);
-                memcpy(data, &ubo, sizeof(ubo));
-                vkUnmapMemory(device, inst.descSet.uniformBuffersMemory[0][currentImage]);
-            }
+            const DescriptorSet &set = entitySets[entities.get(rockArchetypes[kind]).renderHandles[0]];
+
+            UniformBufferObject ubo{};
+            ubo.model = glm::mat4(1.0f);
+            ubo.view = camMatrix;
+            ubo.proj = projMatrix;
+
+            vkMapMemory(device, set.uniformBuffersMemory[0][currentImage], 0, sizeof(ubo), 0, &data);
+            memcpy(data, &ubo, sizeof(ubo));
+            vkUnmapMemory(device, set.uniformBuffersMemory[0][currentImage]);
+
+            instances[kind] = rockInstances[kind].mapped[currentImage];
         }
+        writeRockMatrices(frame.snapshot, alpha, instances);
 
         // Texts
         for (const auto &text : texts)
@@ -644,7 +810,7 @@ protected:
         subo.mMat = glm::mat4(1.0f);
         subo.nMat = glm::mat4(1.0f);
         subo.mvpMat = projMatrix * camMatrix;
-        subo.mvpMat = glm::translate(subo.mvpMat, objects[0].instances[0].position);
+        subo.mvpMat = glm::translate(subo.mvpMat, entities.get(boatArchetype).transforms[0].position);
         subo.mvpMat = glm::scale(subo.mvpMat, glm::vec3(3.0f));
 
         vkMapMemory(device, skybox.descSet.uniformBuffersMemory[0][currentImage], 0, sizeof(subo), 0, &data);
@@ -653,17 +819,497 @@ protected:
     }
 };
 
+// Loads only the geometry of a model, to get its boundaries and hull without Vulkan
+Model loadModelGeometry(const std::string &file)
+{
+    Model model;
+    model.loadModel(file);
+    model.computeBoundaries();
+
+    return model;
+}
+
+// Collision shapes of the boat and of the rock kinds, for the runs without a window
+struct CourseShapes
+{
+    ModelBoundaries boatBoundaries;
+    ConvexHull boatHull;
+    std::vector<RockKind> rockKinds;
+};
+
+CourseShapes loadCourseShapes()
+{
+    Model boat = loadModelGeometry(BOAT_MODEL_PATH);
+    Model rock1 = loadModelGeometry(ROCK1_MODEL_PATH);
+    Model rock2 = loadModelGeometry(ROCK2_MODEL_PATH);
+
+    return {boat.boundaries, boat.hull,
+            {{ROCK1_DEFAULT_SCALE, rock1.boundaries, rock1.hull},
+             {ROCK2_DEFAULT_SCALE, rock2.boundaries, rock2.hull}}};
+}
+
+// Prints the heap allocations made by a timed loop, when counting them.
+// The loops must not allocate once set up: any allocation fails the run
+int reportAllocations(unsigned long allocations)
+{
+    if (!ALLOCATION_COUNTING)
+    {
+        return EXIT_SUCCESS;
+    }
+
+    std::cout << "Allocations: " << allocations << std::endl;
+
+    return allocations == 0 ? EXIT_SUCCESS : EXIT_FAILURE;
+}
+
+// Runs the game logic flat out, without window, swapchain or GPU, and reports its throughput.
+// The boat goes straight, or steers with the autopilot, whose rollouts are counted apart
+int runHeadless(uint64_t seed, long steps, int threads, int rocks, bool autopilotEnabled)
+{
+    ThreadPool pool(threads);
+    CourseStream courseStream;
+
+    CourseShapes shapes = loadCourseShapes();
+
+    GameCore core;
+    core.pool = &pool;
+    core.courseStream = &courseStream;
+    core.init(seed, shapes.boatBoundaries, shapes.rockKinds, getRockCounts(rocks), shapes.boatHull);
+
+    Autopilot autopilot;
+    if (autopilotEnabled)
+    {
+        autopilot.init(core, &pool);
+    }
+
+    long episodes = 0;
+    long wins = 0;
+
+    unsigned long startAllocations = allocationCount();
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    for (long i = 0; i < steps; ++i)
+    {
+        GameEvent event = core.step(SIM_STEP, autopilotEnabled ? autopilot.steer(core) : 0);
+
+        if (event != Playing)
+        {
+            episodes++;
+            wins += event == Win;
+            core.restart();
+            autopilot.reset();
+        }
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    unsigned long allocations = allocationCount() - startAllocations;
+    double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+
+    flushLog();
+
+    std::cout << "Seed: " << seed << std::endl;
+    std::cout << "Threads: " << pool.size() << std::endl;
+    std::cout << "Rocks: " << core.rocks.size() << std::endl;
+    std::cout << "Steps: " << steps << std::endl;
+    std::cout << "Episodes: " << episodes << " (" << wins << " won)" << std::endl;
+    std::cout << "Highscore: " << core.game.highscore << std::endl;
+    std::cout << "Elapsed: " << elapsed << " s" << std::endl;
+    std::cout << "Steps/sec: " << steps / elapsed << std::endl;
+
+    if (autopilotEnabled)
+    {
+        std::cout << "Rollout steps: " << autopilot.rolloutSteps << std::endl;
+        std::cout << "Rollout steps/sec: " << autopilot.rolloutSteps / elapsed << std::endl;
+    }
+
+    return reportAllocations(allocations);
+}
+
+// Runs envs independent games in lockstep, all going straight, and reports the aggregate throughput
+int runBatch(uint64_t seed, long steps, int threads, int rocks, int envs)
+{
+    ThreadPool pool(threads);
+
+    CourseShapes shapes = loadCourseShapes();
+
+    BatchRunner batch;
+    batch.init(seed, envs, shapes.boatBoundaries, shapes.rockKinds, getRockCounts(rocks), shapes.boatHull, &pool);
+
+    std::vector<int> actions(envs, 0);
+
+    unsigned long startAllocations = allocationCount();
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    for (long i = 0; i < steps; ++i)
+    {
+        batch.step(actions.data());
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    unsigned long allocations = allocationCount() - startAllocations;
+    double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+
+    flushLog();
+
+    std::cout << "Seed: " << seed << std::endl;
+    std::cout << "Threads: " << pool.size() << std::endl;
+    std::cout << "Envs: " << envs << std::endl;
+    std::cout << "Steps: " << batch.steps << " (" << steps << " per env)" << std::endl;
+    std::cout << "Episodes: " << batch.episodes << " (" << batch.wins << " won)" << std::endl;
+    std::cout << "Highscore: " << batch.highscore() << std::endl;
+    std::cout << "Elapsed: " << elapsed << " s" << std::endl;
+    std::cout << "Steps/sec: " << batch.steps / elapsed << std::endl;
+
+    return reportAllocations(allocations);
+}
+
+// Runs boats on one course, each one steering at random, and reports the throughput in steps
+// of the course and in steps of the boats afloat
+int runSharedCourse(uint64_t seed, long steps, int threads, int rocks, int boats)
+{
+    ThreadPool pool(threads);
+    CourseStream courseStream;
+
+    CourseShapes shapes = loadCourseShapes();
+
+    SharedCourse course;
+    course.core.pool = &pool;
+    course.core.courseStream = &courseStream;
+    course.init(seed, boats, shapes.boatBoundaries, shapes.rockKinds, getRockCounts(rocks), shapes.boatHull);
+
+    uint64_t state = seed;
+    RngStream random;
+    random.seed(splitMix64(state));
+
+    std::vector<int> horDirs(boats, 0);
+
+    long episodes = 0;
+    long wins = 0;
+    long boatSteps = 0;
+
+    unsigned long startAllocations = allocationCount();
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    for (long i = 0; i < steps; ++i)
+    {
+        if (i % SHARED_COURSE_STEER_STEPS == 0)
+        {
+            for (int &horDir : horDirs)
+            {
+                horDir = std::min(2, static_cast<int>(random.uniform(0.0f, 3.0f))) - 1;
+            }
+        }
+
+        GameEvent event = course.step(SIM_STEP, horDirs.data());
+        boatSteps += course.afloat;
+
+        if (event != Playing)
+        {
+            episodes++;
+            wins += event == Win;
+            course.restart();
+        }
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    unsigned long allocations = allocationCount() - startAllocations;
+    double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+
+    flushLog();
+
+    std::cout << "Seed: " << seed << std::endl;
+    std::cout << "Threads: " << pool.size() << std::endl;
+    std::cout << "Boats: " << boats << std::endl;
+    std::cout << "Rocks: " << course.core.rocks.size() << std::endl;
+    std::cout << "Steps: " << steps << std::endl;
+    std::cout << "Episodes: " << episodes << " (" << wins << " won)" << std::endl;
+    std::cout << "Highscore: " << course.core.game.highscore << std::endl;
+    std::cout << "Elapsed: " << elapsed << " s" << std::endl;
+    std::cout << "Steps/sec: " << steps / elapsed << std::endl;
+    std::cout << "Boat steps/sec: " << boatSteps / elapsed << std::endl;
+
+    return reportAllocations(allocations);
+}
+
+// Scaling benchmark of everything that touches the rocks: runs the game going straight on rock
+// fields ten times larger each time, up to rocks, and reports the mean time of each stage.
+// Every STRESS_FRAME_STEPS it also does the CPU side of a frame, the snapshot handed to the
+// render thread and the rock instances written from it, as the windowed game writes them into
+// its instance buffers. Dense runs widen the course to keep every rock close to the boat
+int runStress(uint64_t seed, long steps, int threads, int rocks, bool dense)
+{
+    ThreadPool pool(threads);
+
+    CourseShapes shapes = loadCourseShapes();
+
+    std::cout << "Seed: " << seed << std::endl;
+    std::cout << "Threads: " << pool.size() << std::endl;
+    std::cout << "Steps: " << steps << " per field" << std::endl;
+    std::cout << "Course: " << (dense ? "dense" : "default width") << std::endl;
+    std::cout << "Mean time per run, in microseconds" << std::endl;
+
+    std::cout << std::setw(10) << "rocks" << std::setw(12) << "steps/sec" << std::setw(10) << "episodes";
+    for (int s = 0; s < STAGES; ++s)
+    {
+        std::cout << std::setw(12) << STAGE_NAMES[s];
+    }
+    std::cout << std::endl;
+
+    unsigned long allocations = 0;
+
+    for (long n = std::min(STRESS_MIN_ROCKS, rocks);; n = std::min(10 * n, static_cast<long>(rocks)))
+    {
+        CourseStream courseStream;
+        StageTimings timings;
+
+        const std::vector<int> counts = getRockCounts(n);
+
+        GameCore core;
+        core.pool = &pool;
+        core.courseStream = &courseStream;
+        core.denseCourse = dense;
+        core.init(seed, shapes.boatBoundaries, shapes.rockKinds, counts, shapes.boatHull);
+
+        GameSnapshot frame;
+        core.saveSnapshot(frame);
+
+        std::vector<Instance> instances[ROCK_KINDS];
+        Instance *frameInstances[ROCK_KINDS];
+        for (int kind = 0; kind < ROCK_KINDS; ++kind)
+        {
+            instances[kind].resize(counts[kind]);
+            frameInstances[kind] = instances[kind].data();
+        }
+
+        long episodes = 0;
+
+        core.timings = &timings;
+        unsigned long startAllocations = allocationCount();
+        auto startTime = std::chrono::high_resolution_clock::now();
+
+        for (long i = 1; i <= steps; ++i)
+        {
+            if (core.step(SIM_STEP, 0) != Playing)
+            {
+                episodes++;
+                core.restart();
+            }
+
+            if (i % STRESS_FRAME_STEPS == 0)
+            {
+                StageTimer timer(&timings, StageUpload);
+                core.saveSnapshot(frame);
+                writeRockMatrices(frame, 1.0f, frameInstances);
+            }
+        }
+
+        auto endTime = std::chrono::high_resolution_clock::now();
+        allocations += allocationCount() - startAllocations;
+        double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+
+        flushLog();
+
+        std::cout << std::setw(10) << core.rocks.size() << std::setw(12) << static_cast<long>(steps / elapsed) << std::setw(10) << episodes;
+        for (int s = 0; s < STAGES; ++s)
+        {
+            const double mean = timings.runs[s] > 0 ? 1e6 * timings.seconds[s] / timings.runs[s] : 0.0;
+            std::cout << std::setw(12) << std::fixed << std::setprecision(2) << mean << std::defaultfloat;
+        }
+        std::cout << std::endl;
+
+        if (n >= rocks)
+        {
+            break;
+        }
+    }
+
+    return reportAllocations(allocations);
+}
+
+// Plays back a log written with --record as fast as possible, checking the state hashes.
+// Fails at the first checkpoint where the game diverged from the recorded one
+int runReplay(const std::string &file)
+{
+    InputLogReader log;
+    log.load(file);
+
+    CourseShapes shapes = loadCourseShapes();
+
+    GameCore core;
+    core.init(log.seed, shapes.boatBoundaries, shapes.rockKinds, getRockCounts(log.rocks), shapes.boatHull);
+
+    long steps = 0;
+    long checkedSteps = 0;
+    long episodes = 0;
+    uint64_t chain = 0;
+
+    auto startTime = std::chrono::high_resolution_clock::now();
+
+    while (log.next())
+    {
+        if (log.tag <= TagSteerRight)
+        {
+            const int horDir = log.tag - 1;
+
+            for (uint64_t i = 0; i < log.value; ++i)
+            {
+                episodes += core.step(SIM_STEP, horDir) != Playing;
+                chain = chainStateHash(chain, core.stateHash());
+            }
+            steps += log.value;
+        }
+        else if (log.tag == TagRestart)
+        {
+            core.restart();
+        }
+        else if (log.value != chain)
+        {
+            flushLog();
+            std::cerr << "Replay diverged between steps " << checkedSteps << " and " << steps << std::endl;
+            return EXIT_FAILURE;
+        }
+        else
+        {
+            checkedSteps = steps;
+        }
+    }
+
+    auto endTime = std::chrono::high_resolution_clock::now();
+    double elapsed = std::chrono::duration<double>(endTime - startTime).count();
+
+    flushLog();
+
+    std::cout << "Seed: " << log.seed << std::endl;
+    std::cout << "Steps: " << steps << " (all hashes match)" << std::endl;
+    std::cout << "Episodes: " << episodes << std::endl;
+    std::cout << "Highscore: " << core.game.highscore << std::endl;
+    std::cout << "Elapsed: " << elapsed << " s" << std::endl;
+    std::cout << "Steps/sec: " << steps / elapsed << std::endl;
+
+    return EXIT_SUCCESS;
+}
+
 // This is the main: probably you do not need to touch this!
-int main()
+int main(int argc, char *argv[])
 {
-    BoatRunner app;
+    bool headless = false;
+    long steps = 0;
+    uint64_t seed = std::chrono::high_resolution_clock::now().time_since_epoch().count();
+    int threads = 1;
+    int envs = 0;
+    int rocks = 0;
+    int boats = 0;
+    bool autopilot = false;
+    bool stress = false;
+    bool dense = false;
+    std::string recordFile;
+    std::string replayFile;
+
+    for (int i = 1; i < argc; ++i)
+    {
+        std::string arg = argv[i];
+
+        if (arg == "--headless")
+        {
+            headless = true;
+        }
+        else if (arg == "--steps" && i + 1 < argc)
+        {
+            steps = std::atol(argv[++i]);
+        }
+        else if (arg == "--seed" && i + 1 < argc)
+        {
+            seed = std::strtoull(argv[++i], nullptr, 10);
+        }
+        else if (arg == "--threads" && i + 1 < argc)
+        {
+            threads = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--record" && i + 1 < argc)
+        {
+            recordFile = argv[++i];
+        }
+        else if (arg == "--replay" && i + 1 < argc)
+        {
+            replayFile = argv[++i];
+        }
+        else if (arg == "--envs" && i + 1 < argc)
+        {
+            envs = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--rocks" && i + 1 < argc)
+        {
+            rocks = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--boats" && i + 1 < argc)
+        {
+            boats = std::max(1, std::atoi(argv[++i]));
+        }
+        else if (arg == "--autopilot")
+        {
+            autopilot = true;
+        }
+        else if (arg == "--stress")
+        {
+            stress = true;
+        }
+        else if (arg == "--dense")
+        {
+            dense = true;
+        }
+    }
+
+    if (!replayFile.empty() || headless || stress)
+    {
+        try
+        {
+            if (!replayFile.empty())
+            {
+                return runReplay(replayFile);
+            }
+
+            if (stress)
+            {
+                return runStress(seed, steps > 0 ? steps : STRESS_DEFAULT_STEPS, threads, rocks > 0 ? rocks : STRESS_DEFAULT_ROCKS, dense);
+            }
+
+            if (steps <= 0)
+            {
+                steps = HEADLESS_DEFAULT_STEPS;
+            }
+
+            if (envs > 0)
+            {
+                return runBatch(seed, steps, threads, rocks, envs);
+            }
+
+            if (boats > 0)
+            {
+                return runSharedCourse(seed, steps, threads, rocks, boats);
+            }
+
+            return runHeadless(seed, steps, threads, rocks, autopilot);
+        }
+        catch (const std::exception &e)
+        {
+            flushLog();
+            std::cerr << e.what() << std::endl;
+            return EXIT_FAILURE;
+        }
+    }
+
+    std::cout << "Seed: " << seed << std::endl;
+
+    BoatRunner app(seed, rocks, recordFile, autopilot, threads);
 
     try
     {
         app.run();
+        app.saveRecording();
     }
     catch (const std::exception &e)
     {
+        flushLog();
         std::cerr << e.what() << std::endl;
         return EXIT_FAILURE;
     }
@@ -4,6 +4,7 @@
 #include <GLFW/glfw3.h>
 
 #include <iostream>
+#include <iomanip>
 #include <stdexcept>
 #include <cstdlib>
 #include <vector>
@@ -23,6 +24,10 @@
 
 #include <chrono>
 
+#include "collision_box.hpp"
+#include "convex_hull.hpp"
+#include "log.hpp"
+
 #define TINYOBJLOADER_IMPLEMENTATION
 #include <tiny_obj_loader.h>
 
@@ -108,6 +113,40 @@ struct Vertex
     };
 };
 
+// Model matrix of an instanced draw, one per instance in binding 1.
+// A mat4 input takes four locations, one per column, after the vertex ones
+struct Instance
+{
+    glm::mat4 model;
+
+    static VkVertexInputBindingDescription getBindingDescription()
+    {
+        VkVertexInputBindingDescription bindingDescription{};
+        bindingDescription.binding = 1;
+        bindingDescription.stride = sizeof(Instance);
+        bindingDescription.inputRate = VK_VERTEX_INPUT_RATE_INSTANCE;
+
+        return bindingDescription;
+    }
+
+    static std::array<VkVertexInputAttributeDescription, 4>
+    getAttributeDescriptions()
+    {
+        std::array<VkVertexInputAttributeDescription, 4>
+            attributeDescriptions{};
+
+        for (uint32_t column = 0; column < attributeDescriptions.size(); ++column)
+        {
+            attributeDescriptions[column].binding = 1;
+            attributeDescriptions[column].location = 3 + column;
+            attributeDescriptions[column].format = VK_FORMAT_R32G32B32A32_SFLOAT;
+            attributeDescriptions[column].offset = offsetof(Instance, model) + column * sizeof(glm::vec4);
+        }
+
+        return attributeDescriptions;
+    }
+};
+
 // Lesson 13
 struct QueueFamilyIndices
 {
@@ -207,17 +246,11 @@ void PrintVkError(VkResult result)
             break;
         }
     }
-    std::cout << "Error: " << result << ", " << meaning << "\n";
+    logError("Error: ", result, ", ", meaning);
 }
 
 class BaseProject;
 
-struct ModelBoundaries
-{
-    float minX, minY, minZ;
-    float maxX, maxY, maxZ;
-};
-
 struct Model
 {
     BaseProject *BP;
@@ -229,6 +262,7 @@ struct Model
     VkDeviceMemory indexBufferMemory;
 
     ModelBoundaries boundaries;
+    ConvexHull hull;
 
     void loadModel(std::string file);
     void createIndexBuffer();
@@ -295,8 +329,10 @@ struct Pipeline
     VkPipeline graphicsPipeline;
     VkPipelineLayout pipelineLayout;
 
+    // instanced pipelines also read an Instance per instance, from binding 1
     void init(BaseProject *bp, const std::string &VertShader, const std::string &FragShader,
-              std::vector<DescriptorSetLayout *> D, VkCompareOp compareOp, VkCullModeFlagBits cullMode);
+              std::vector<DescriptorSetLayout *> D, VkCompareOp compareOp, VkCullModeFlagBits cullMode,
+              bool instanced = false);
     VkShaderModule createShaderModule(const std::vector<char> &code);
     static std::vector<char> readFile(const std::string &filename);
     void cleanup();
@@ -333,32 +369,23 @@ struct DescriptorSet
     void cleanup();
 };
 
-enum ObjectType
+// Per instance data of an instanced draw, one host visible buffer per swapchain image.
+// The buffers stay mapped, so that a frame writes the instances in place
+struct InstanceBuffer
 {
-    Boat,
-    Rock,
-    Ocean
-};
-
-struct ObjectInstance
-{
-public:
-    DescriptorSet descSet;
+    BaseProject *BP;
 
-    glm::vec3 position;
-    glm::vec3 rotation;
-    glm::vec3 scale;
+    int capacity = 0;
 
-    ObjectType type;
+    std::vector<VkBuffer> buffers;
+    std::vector<VkDeviceMemory> buffersMemory;
+    std::vector<Instance *> mapped;
 
-    ObjectInstance(ObjectType type, glm::vec3 pos, glm::vec3 rotation, glm::vec3 scale) : type(type),
-                                                                                          position(pos),
-                                                                                          rotation(rotation),
-                                                                                          scale(scale){};
-    void init(BaseProject *bp, DescriptorSetLayout *L, std::vector<DescriptorSetElement> E);
+    void init(BaseProject *bp, int instances);
     void cleanup();
 };
 
+// Mesh and texture shared by the entities drawn with it
 class Object
 {
 public:
@@ -369,8 +396,6 @@ public:
     const std::string modelFile;
     const std::string textureFile;
 
-    std::vector<ObjectInstance> instances;
-
     Object(std::string model, std::string texture, float defaultScale) : modelFile(model),
                                                                          textureFile(texture),
                                                                          defaultScale(defaultScale){};
@@ -426,6 +451,7 @@ class BaseProject
     friend class Pipeline;
     friend class DescriptorSetLayout;
     friend class DescriptorSet;
+    friend class InstanceBuffer;
 
 public:
     virtual void setWindowParameters() = 0;
@@ -654,7 +680,7 @@ protected:
         const VkDebugUtilsMessengerCallbackDataEXT *pCallbackData, void *pUserData)
     {
 
-        std::cerr << "validation layer: " << pCallbackData->pMessage << std::endl;
+        logWarning("validation layer: ", pCallbackData->pMessage);
         return VK_FALSE;
     }
 
@@ -695,7 +721,7 @@ protected:
         std::vector<VkPhysicalDevice> devices(deviceCount);
         vkEnumeratePhysicalDevices(instance, &deviceCount, devices.data());
 
-        std::cout << "Physical devices found: " << deviceCount << "\n";
+        logDebug("Physical devices found: ", deviceCount);
 
         for (const auto &device : devices)
         {
@@ -1898,9 +1924,18 @@ void Model::computeBoundaries()
     boundaries.minZ = std::abs((*minZ).pos.z);
     boundaries.maxZ = std::abs((*maxZ).pos.z);
 
-    std::cout << "Object min size (x, y, z) = (" << boundaries.minX << ", " << boundaries.minY << ", " << boundaries.minZ << ")" << std::endl;
-    std::cout << "Object max size (x, y, z) = (" << boundaries.maxX << ", " << boundaries.maxY << ", " << boundaries.maxZ << ")" << std::endl
-              << std::endl;
+    // Outline seen from above, for the collision narrowphase
+    std::vector<glm::vec2> points;
+    points.reserve(vertices.size());
+    for (const auto &vertex : vertices)
+    {
+        points.push_back(glm::vec2(vertex.pos.x, vertex.pos.z));
+    }
+    hull = computeConvexHull(points);
+
+    logDebug("Object min size (x, y, z) = (", boundaries.minX, ", ", boundaries.minY, ", ", boundaries.minZ, ")");
+    logDebug("Object max size (x, y, z) = (", boundaries.maxX, ", ", boundaries.maxY, ", ", boundaries.maxZ, ")");
+    logDebug("");
 }
 
 void Model::init(BaseProject *bp, std::string file)
@@ -2020,15 +2055,16 @@ void Texture::cleanup()
 }
 
 void Pipeline::init(BaseProject *bp, const std::string &VertShader, const std::string &FragShader,
-                    std::vector<DescriptorSetLayout *> D, VkCompareOp compareOp, VkCullModeFlagBits cullMode)
+                    std::vector<DescriptorSetLayout *> D, VkCompareOp compareOp, VkCullModeFlagBits cullMode,
+                    bool instanced)
 {
     BP = bp;
 
     auto vertShaderCode = readFile(VertShader);
     auto fragShaderCode = readFile(FragShader);
 
-    std::cout << "Vertex shader len: " << vertShaderCode.size() << "\n";
-    std::cout << "Fragment shader len: " << fragShaderCode.size() << "\n";
+    logDebug("Vertex shader len: ", vertShaderCode.size());
+    logDebug("Fragment shader len: ", fragShaderCode.size());
 
     VkShaderModule vertShaderModule =
         createShaderModule(vertShaderCode);
@@ -2056,13 +2092,22 @@ void Pipeline::init(BaseProject *bp, const std::string &VertShader, const std::s
     VkPipelineVertexInputStateCreateInfo vertexInputInfo{};
     vertexInputInfo.sType =
         VK_STRUCTURE_TYPE_PIPELINE_VERTEX_INPUT_STATE_CREATE_INFO;
-    auto bindingDescription = Vertex::getBindingDescription();
-    auto attributeDescriptions = Vertex::getAttributeDescriptions();
+    std::vector<VkVertexInputBindingDescription> bindingDescriptions = {Vertex::getBindingDescription()};
+    auto vertexAttributes = Vertex::getAttributeDescriptions();
+    std::vector<VkVertexInputAttributeDescription> attributeDescriptions(vertexAttributes.begin(), vertexAttributes.end());
+
+    if (instanced)
+    {
+        auto instanceAttributes = Instance::getAttributeDescriptions();
+        bindingDescriptions.push_back(Instance::getBindingDescription());
+        attributeDescriptions.insert(attributeDescriptions.end(), instanceAttributes.begin(), instanceAttributes.end());
+    }
 
-    vertexInputInfo.vertexBindingDescriptionCount = 1;
+    vertexInputInfo.vertexBindingDescriptionCount =
+        static_cast<uint32_t>(bindingDescriptions.size());
     vertexInputInfo.vertexAttributeDescriptionCount =
         static_cast<uint32_t>(attributeDescriptions.size());
-    vertexInputInfo.pVertexBindingDescriptions = &bindingDescription;
+    vertexInputInfo.pVertexBindingDescriptions = bindingDescriptions.data();
     vertexInputInfo.pVertexAttributeDescriptions =
         attributeDescriptions.data();
 
@@ -2425,31 +2470,51 @@ void DescriptorSet::cleanup()
     }
 }
 
-void Object::init(BaseProject *bp)
+void InstanceBuffer::init(BaseProject *bp, int instances)
 {
-    model.init(bp, modelFile);
-    texture.init(bp, textureFile);
+    BP = bp;
+    capacity = instances;
+
+    buffers.resize(BP->swapChainImages.size());
+    buffersMemory.resize(BP->swapChainImages.size());
+    mapped.resize(BP->swapChainImages.size());
+
+    // An empty buffer cannot be created, it just goes unused
+    VkDeviceSize bufferSize = std::max(capacity, 1) * sizeof(Instance);
+
+    for (size_t i = 0; i < BP->swapChainImages.size(); i++)
+    {
+        BP->createBuffer(bufferSize, VK_BUFFER_USAGE_VERTEX_BUFFER_BIT,
+                         VK_MEMORY_PROPERTY_HOST_VISIBLE_BIT |
+                             VK_MEMORY_PROPERTY_HOST_COHERENT_BIT,
+                         buffers[i], buffersMemory[i]);
+
+        void *data;
+        vkMapMemory(BP->device, buffersMemory[i], 0, bufferSize, 0, &data);
+        mapped[i] = static_cast<Instance *>(data);
+    }
 }
 
-void Object::cleanup()
+void InstanceBuffer::cleanup()
 {
-    for (auto &inst : instances)
+    for (size_t i = 0; i < buffers.size(); i++)
     {
-        inst.cleanup();
+        vkUnmapMemory(BP->device, buffersMemory[i]);
+        vkDestroyBuffer(BP->device, buffers[i], nullptr);
+        vkFreeMemory(BP->device, buffersMemory[i], nullptr);
     }
-
-    texture.cleanup();
-    model.cleanup();
 }
 
-void ObjectInstance::init(BaseProject *bp, DescriptorSetLayout *L, std::vector<DescriptorSetElement> E)
+void Object::init(BaseProject *bp)
 {
-    descSet.init(bp, L, E);
+    model.init(bp, modelFile);
+    texture.init(bp, textureFile);
 }
 
-void ObjectInstance::cleanup()
+void Object::cleanup()
 {
-    descSet.cleanup();
+    texture.cleanup();
+    model.cleanup();
 }
 
 void SkyBoxModel::init(BaseProject *bp, DescriptorSetLayout *L, std::vector<DescriptorSetElement> E)
@@ -2482,11 +2547,10 @@ void CubicTexture::createCubicTextureImage(std::vector<std::string> files)
                               &texChannels, STBI_rgb_alpha);
         if (!pixels[i])
         {
-            std::cout << files[i].c_str() << "\n";
+            logError(files[i]);
             throw std::runtime_error("failed to load texture image!");
         }
-        std::cout << files[i] << " -> size: " << texWidth
-                  << "x" << texHeight << ", ch: " << texChannels << "\n";
+        logDebug(files[i], " -> size: ", texWidth, "x", texHeight, ", ch: ", texChannels);
     }
 
     VkDeviceSize imageSize = texWidth * texHeight * 4;
@@ -1,6 +1,16 @@
+#pragma once
+
 #include <glm/glm.hpp>
+#include <algorithm>
 #include <iostream>
 
+// Half extents of a mesh along each axis, measured from its origin
+struct ModelBoundaries
+{
+    float minX, minY, minZ;
+    float maxX, maxY, maxZ;
+};
+
 class CollisionBox
 {
     float minX, minY, maxX, maxY;
@@ -15,6 +25,11 @@ public:
         maxY = pos.y + max2;
     }
 
+    float getMinX() const { return minX; }
+    float getMaxX() const { return maxX; }
+    float getMinY() const { return minY; }
+    float getMaxY() const { return maxY; }
+
     bool checkCollision(CollisionBox &obj)
     {
         return checkCollisionOnAxis(minX, maxX, obj.minX, obj.maxX) &&
@@ -32,4 +47,15 @@ public:
             return min1 < max2;
         }
     }
+
+    // Box covering this one all along a move by displacement
+    CollisionBox sweep(glm::vec2 displacement) const
+    {
+        float sweptMinX = std::min(minX, minX + displacement.x);
+        float sweptMaxX = std::max(maxX, maxX + displacement.x);
+        float sweptMinY = std::min(minY, minY + displacement.y);
+        float sweptMaxY = std::max(maxY, maxY + displacement.y);
+
+        return CollisionBox(glm::vec2(0.0f), -sweptMinX, sweptMaxX, -sweptMinY, sweptMaxY);
+    }
 };
\ No newline at end of file
@@ -0,0 +1,332 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#if defined(__x86_64__) || defined(__i386__)
+#include <immintrin.h>
+#define BOAT_RUNNER_X86 1
+#endif
+
+#include "collision_box.hpp"
+#include "rock_field.hpp"
+
+const int OBB_SWEEP_AXES = 4;
+
+// Box of a model turned about Y by a yaw, on the XZ plane.
+// The axes are where the model X and Z axes end up, as glm::rotate turns them
+struct OrientedBox
+{
+    glm::vec2 center;
+    glm::vec2 axisX;
+    glm::vec2 axisZ;
+    float halfX;
+    float halfZ;
+
+    OrientedBox(glm::vec2 position, float yawDegrees, float scale, const ModelBoundaries &boundaries)
+    {
+        const float yaw = yawDegrees * 0.017453292519943295f;
+        const float c = std::cos(yaw);
+        const float s = std::sin(yaw);
+
+        axisX = glm::vec2(c, -s);
+        axisZ = glm::vec2(s, c);
+
+        halfX = 0.5f * (boundaries.minX + boundaries.maxX) * scale;
+        halfZ = 0.5f * (boundaries.minZ + boundaries.maxZ) * scale;
+
+        // The model origin is not the middle of its box
+        const float offsetX = 0.5f * (boundaries.maxX - boundaries.minX) * scale;
+        const float offsetZ = 0.5f * (boundaries.maxZ - boundaries.minZ) * scale;
+        center = position + axisX * offsetX + axisZ * offsetZ;
+    }
+
+    // Smallest axis aligned box around it
+    CollisionBox getBounds() const
+    {
+        const float extentX = halfX * std::abs(axisX.x) + halfZ * std::abs(axisZ.x);
+        const float extentZ = halfX * std::abs(axisX.y) + halfZ * std::abs(axisZ.y);
+
+        return CollisionBox(center, extentX, extentX, extentZ, extentZ);
+    }
+
+    // Model space point, scaled, to its offset from the box origin in world space
+    glm::vec2 rotate(glm::vec2 point) const
+    {
+        return axisX * point.x + axisZ * point.y;
+    }
+};
+
+// Separating axis test of a still oriented box against rock boxes that all moved by the
+// same displacement, set up once per query. The candidate axes are X and Z, for the rocks,
+// and the two box axes; along each, the projections overlap during an interval of the move,
+// and a rock hits if the intervals of the four axes meet within it
+struct ObbSweep
+{
+    float centerX, centerZ;
+
+    // Per axis: direction, its absolute components, the box extent along it,
+    // how far the rocks move along it and the inverse, and whether they move at all
+    float axisX[OBB_SWEEP_AXES];
+    float axisZ[OBB_SWEEP_AXES];
+    float absX[OBB_SWEEP_AXES];
+    float absZ[OBB_SWEEP_AXES];
+    float extent[OBB_SWEEP_AXES];
+    float shift[OBB_SWEEP_AXES];
+    float inverseShift[OBB_SWEEP_AXES];
+    bool moving[OBB_SWEEP_AXES];
+
+    ObbSweep(const OrientedBox &box, glm::vec2 displacement)
+    {
+        centerX = box.center.x;
+        centerZ = box.center.y;
+
+        const glm::vec2 axes[OBB_SWEEP_AXES] = {glm::vec2(1.0f, 0.0f), glm::vec2(0.0f, 1.0f), box.axisX, box.axisZ};
+
+        for (int k = 0; k < OBB_SWEEP_AXES; ++k)
+        {
+            axisX[k] = axes[k].x;
+            axisZ[k] = axes[k].y;
+            absX[k] = std::abs(axes[k].x);
+            absZ[k] = std::abs(axes[k].y);
+            extent[k] = box.halfX * std::abs(glm::dot(box.axisX, axes[k])) + box.halfZ * std::abs(glm::dot(box.axisZ, axes[k]));
+            shift[k] = glm::dot(displacement, axes[k]);
+            moving[k] = shift[k] != 0.0f;
+            inverseShift[k] = moving[k] ? 1.0f / shift[k] : 0.0f;
+        }
+    }
+};
+
+// Batched swept test of the rocks, stored as arrays, against an ObbSweep.
+// hitMasks gets one byte per block of 8 rocks, bit j set if rock 8 * block + j hits the box.
+// Every kernel returns the number of rocks hit
+typedef int (*ObbBatchKernel)(const float *x, const float *z,
+                              const float *minX, const float *maxX,
+                              const float *minZ, const float *maxZ,
+                              int count, const ObbSweep &sweep, uint8_t *hitMasks);
+
+inline int obbBatchScalar(const float *x, const float *z,
+                          const float *minX, const float *maxX,
+                          const float *minZ, const float *maxZ,
+                          int count, const ObbSweep &sweep, uint8_t *hitMasks)
+{
+    int hits = 0;
+
+    for (int block = 0; block * 8 < count; ++block)
+    {
+        uint8_t mask = 0;
+
+        for (int j = 0; j < 8 && block * 8 + j < count; ++j)
+        {
+            const int i = block * 8 + j;
+
+            // Rock box center relative to the box center, and half extents
+            const float cx = x[i] + 0.5f * (maxX[i] - minX[i]) - sweep.centerX;
+            const float cz = z[i] + 0.5f * (maxZ[i] - minZ[i]) - sweep.centerZ;
+            const float hx = 0.5f * (minX[i] + maxX[i]);
+            const float hz = 0.5f * (minZ[i] + maxZ[i]);
+
+            bool hit = true;
+            float enter = 0.0f;
+            float exit = 1.0f;
+
+            for (int k = 0; k < OBB_SWEEP_AXES; ++k)
+            {
+                const float p = cx * sweep.axisX[k] + cz * sweep.axisZ[k];
+                const float r = hx * sweep.absX[k] + hz * sweep.absZ[k] + sweep.extent[k];
+
+                if (sweep.moving[k])
+                {
+                    // Projection at the start of the move
+                    const float start = p - sweep.shift[k];
+                    const float t1 = (-r - start) * sweep.inverseShift[k];
+                    const float t2 = (r - start) * sweep.inverseShift[k];
+
+                    enter = std::max(enter, std::min(t1, t2));
+                    exit = std::min(exit, std::max(t1, t2));
+                }
+                else
+                {
+                    hit &= std::abs(p) < r;
+                }
+            }
+
+            hit &= enter < exit;
+            mask |= static_cast<uint8_t>(hit) << j;
+            hits += hit;
+        }
+
+        hitMasks[block] = mask;
+    }
+
+    return hits;
+}
+
+#ifdef BOAT_RUNNER_X86
+
+__attribute__((target("sse2"))) inline int obbBatchSse(const float *x, const float *z,
+                                                        const float *minX, const float *maxX,
+                                                        const float *minZ, const float *maxZ,
+                                                        int count, const ObbSweep &sweep, uint8_t *hitMasks)
+{
+    const __m128 half = _mm_set1_ps(0.5f);
+    const __m128 signMask = _mm_set1_ps(-0.0f);
+    const __m128 centerX = _mm_set1_ps(sweep.centerX);
+    const __m128 centerZ = _mm_set1_ps(sweep.centerZ);
+    const int full = count & ~7;
+    int hits = 0;
+
+    for (int i = 0; i < full; i += 8)
+    {
+        int mask = 0;
+
+        for (int part = 0; part < 2; ++part)
+        {
+            const int n = i + 4 * part;
+            const __m128 lowX = _mm_loadu_ps(minX + n);
+            const __m128 highX = _mm_loadu_ps(maxX + n);
+            const __m128 lowZ = _mm_loadu_ps(minZ + n);
+            const __m128 highZ = _mm_loadu_ps(maxZ + n);
+
+            const __m128 cx = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(x + n), _mm_mul_ps(half, _mm_sub_ps(highX, lowX))), centerX);
+            const __m128 cz = _mm_sub_ps(_mm_add_ps(_mm_loadu_ps(z + n), _mm_mul_ps(half, _mm_sub_ps(highZ, lowZ))), centerZ);
+            const __m128 hx = _mm_mul_ps(half, _mm_add_ps(lowX, highX));
+            const __m128 hz = _mm_mul_ps(half, _mm_add_ps(lowZ, highZ));
+
+            __m128 hit = _mm_castsi128_ps(_mm_set1_epi32(-1));
+            __m128 enter = _mm_setzero_ps();
+            __m128 exit = _mm_set1_ps(1.0f);
+
+            for (int k = 0; k < OBB_SWEEP_AXES; ++k)
+            {
+                const __m128 p = _mm_add_ps(_mm_mul_ps(cx, _mm_set1_ps(sweep.axisX[k])), _mm_mul_ps(cz, _mm_set1_ps(sweep.axisZ[k])));
+                const __m128 r = _mm_add_ps(_mm_add_ps(_mm_mul_ps(hx, _mm_set1_ps(sweep.absX[k])), _mm_mul_ps(hz, _mm_set1_ps(sweep.absZ[k]))),
+                                            _mm_set1_ps(sweep.extent[k]));
+
+                if (sweep.moving[k])
+                {
+                    const __m128 start = _mm_sub_ps(p, _mm_set1_ps(sweep.shift[k]));
+                    const __m128 inverse = _mm_set1_ps(sweep.inverseShift[k]);
+                    const __m128 t1 = _mm_mul_ps(_mm_sub_ps(_mm_xor_ps(r, signMask), start), inverse);
+                    const __m128 t2 = _mm_mul_ps(_mm_sub_ps(r, start), inverse);
+
+                    enter = _mm_max_ps(enter, _mm_min_ps(t1, t2));
+                    exit = _mm_min_ps(exit, _mm_max_ps(t1, t2));
+                }
+                else
+                {
+                    hit = _mm_and_ps(hit, _mm_cmplt_ps(_mm_andnot_ps(signMask, p), r));
+                }
+            }
+
+            hit = _mm_and_ps(hit, _mm_cmplt_ps(enter, exit));
+            mask |= _mm_movemask_ps(hit) << (4 * part);
+        }
+
+        hitMasks[i / 8] = static_cast<uint8_t>(mask);
+        hits += __builtin_popcount(mask);
+    }
+
+    if (full < count)
+    {
+        hits += obbBatchScalar(x + full, z + full, minX + full, maxX + full, minZ + full, maxZ + full,
+                               count - full, sweep, hitMasks + full / 8);
+    }
+
+    return hits;
+}
+
+__attribute__((target("avx2"))) inline int obbBatchAvx2(const float *x, const float *z,
+                                                         const float *minX, const float *maxX,
+                                                         const float *minZ, const float *maxZ,
+                                                         int count, const ObbSweep &sweep, uint8_t *hitMasks)
+{
+    const __m256 half = _mm256_set1_ps(0.5f);
+    const __m256 signMask = _mm256_set1_ps(-0.0f);
+    const __m256 centerX = _mm256_set1_ps(sweep.centerX);
+    const __m256 centerZ = _mm256_set1_ps(sweep.centerZ);
+    const int full = count & ~7;
+    int hits = 0;
+
+    for (int i = 0; i < full; i += 8)
+    {
+        const __m256 lowX = _mm256_loadu_ps(minX + i);
+        const __m256 highX = _mm256_loadu_ps(maxX + i);
+        const __m256 lowZ = _mm256_loadu_ps(minZ + i);
+        const __m256 highZ = _mm256_loadu_ps(maxZ + i);
+
+        const __m256 cx = _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(x + i), _mm256_mul_ps(half, _mm256_sub_ps(highX, lowX))), centerX);
+        const __m256 cz = _mm256_sub_ps(_mm256_add_ps(_mm256_loadu_ps(z + i), _mm256_mul_ps(half, _mm256_sub_ps(highZ, lowZ))), centerZ);
+        const __m256 hx = _mm256_mul_ps(half, _mm256_add_ps(lowX, highX));
+        const __m256 hz = _mm256_mul_ps(half, _mm256_add_ps(lowZ, highZ));
+
+        __m256 hit = _mm256_castsi256_ps(_mm256_set1_epi32(-1));
+        __m256 enter = _mm256_setzero_ps();
+        __m256 exit = _mm256_set1_ps(1.0f);
+
+        for (int k = 0; k < OBB_SWEEP_AXES; ++k)
+        {
+            const __m256 p = _mm256_add_ps(_mm256_mul_ps(cx, _mm256_set1_ps(sweep.axisX[k])), _mm256_mul_ps(cz, _mm256_set1_ps(sweep.axisZ[k])));
+            const __m256 r = _mm256_add_ps(_mm256_add_ps(_mm256_mul_ps(hx, _mm256_set1_ps(sweep.absX[k])), _mm256_mul_ps(hz, _mm256_set1_ps(sweep.absZ[k]))),
+                                           _mm256_set1_ps(sweep.extent[k]));
+
+            if (sweep.moving[k])
+            {
+                const __m256 start = _mm256_sub_ps(p, _mm256_set1_ps(sweep.shift[k]));
+                const __m256 inverse = _mm256_set1_ps(sweep.inverseShift[k]);
+                const __m256 t1 = _mm256_mul_ps(_mm256_sub_ps(_mm256_xor_ps(r, signMask), start), inverse);
+                const __m256 t2 = _mm256_mul_ps(_mm256_sub_ps(r, start), inverse);
+
+                enter = _mm256_max_ps(enter, _mm256_min_ps(t1, t2));
+                exit = _mm256_min_ps(exit, _mm256_max_ps(t1, t2));
+            }
+            else
+            {
+                hit = _mm256_and_ps(hit, _mm256_cmp_ps(_mm256_andnot_ps(signMask, p), r, _CMP_LT_OQ));
+            }
+        }
+
+        hit = _mm256_and_ps(hit, _mm256_cmp_ps(enter, exit, _CMP_LT_OQ));
+
+        const int mask = _mm256_movemask_ps(hit);
+        hitMasks[i / 8] = static_cast<uint8_t>(mask);
+        hits += __builtin_popcount(mask);
+    }
+
+    if (full < count)
+    {
+        hits += obbBatchScalar(x + full, z + full, minX + full, maxX + full, minZ + full, maxZ + full,
+                               count - full, sweep, hitMasks + full / 8);
+    }
+
+    return hits;
+}
+
+#endif
+
+// Picks the widest kernel the running CPU supports, once
+inline ObbBatchKernel getObbBatchKernel()
+{
+    static const ObbBatchKernel kernel = []() -> ObbBatchKernel
+    {
+#ifdef BOAT_RUNNER_X86
+        __builtin_cpu_init();
+
+        if (__builtin_cpu_supports("avx2"))
+        {
+            return obbBatchAvx2;
+        }
+        if (__builtin_cpu_supports("sse2"))
+        {
+            return obbBatchSse;
+        }
+#endif
+        return obbBatchScalar;
+    }();
+
+    return kernel;
+}
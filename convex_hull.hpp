@@ -0,0 +1,131 @@
+#pragma once
+
+#include <algorithm>
+#include <limits>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Convex polygon in the XZ plane, counterclockwise, in model space
+typedef std::vector<glm::vec2> ConvexHull;
+
+inline float cross2(glm::vec2 o, glm::vec2 a, glm::vec2 b)
+{
+    return (a.x - o.x) * (b.y - o.y) - (a.y - o.y) * (b.x - o.x);
+}
+
+// Convex hull of a point set (Andrew's monotone chain), without collinear points
+inline ConvexHull computeConvexHull(std::vector<glm::vec2> points)
+{
+    std::sort(points.begin(), points.end(), [](const glm::vec2 &a, const glm::vec2 &b)
+              { return a.x < b.x || (a.x == b.x && a.y < b.y); });
+    points.erase(std::unique(points.begin(), points.end()), points.end());
+
+    if (points.size() < 3)
+    {
+        return points;
+    }
+
+    ConvexHull hull(2 * points.size());
+    size_t k = 0;
+
+    // Lower hull, then upper hull
+    for (size_t i = 0; i < points.size(); ++i)
+    {
+        while (k >= 2 && cross2(hull[k - 2], hull[k - 1], points[i]) <= 0.0f)
+        {
+            k--;
+        }
+        hull[k++] = points[i];
+    }
+
+    for (size_t i = points.size() - 1, lower = k + 1; i > 0; --i)
+    {
+        while (k >= lower && cross2(hull[k - 2], hull[k - 1], points[i - 1]) <= 0.0f)
+        {
+            k--;
+        }
+        hull[k++] = points[i - 1];
+    }
+
+    hull.resize(k - 1);
+    return hull;
+}
+
+// Range of the hull, placed at position with the given scale, along axis
+inline void projectHull(const ConvexHull &hull, glm::vec2 position, float scale, glm::vec2 axis, float &min, float &max)
+{
+    min = std::numeric_limits<float>::max();
+    max = std::numeric_limits<float>::lowest();
+
+    for (const glm::vec2 &point : hull)
+    {
+        float p = glm::dot(point, axis);
+        min = std::min(min, p);
+        max = std::max(max, p);
+    }
+
+    const float offset = glm::dot(position, axis);
+    min = min * scale + offset;
+    max = max * scale + offset;
+}
+
+// Narrows [enter, exit] to the times at which the moving hull, moving by displacement,
+// overlaps the still one along the normals of the edges of hull. False if they never do
+inline bool sweepHullAxes(const ConvexHull &hull, const ConvexHull &moving, glm::vec2 movingPosition, float movingScale,
+                          const ConvexHull &still, glm::vec2 stillPosition, float stillScale,
+                          glm::vec2 displacement, float &enter, float &exit)
+{
+    for (size_t i = 0; i < hull.size(); ++i)
+    {
+        const glm::vec2 edge = hull[(i + 1) % hull.size()] - hull[i];
+        const glm::vec2 axis = glm::vec2(edge.y, -edge.x);
+
+        float min1, max1, min2, max2;
+        projectHull(moving, movingPosition, movingScale, axis, min1, max1);
+        projectHull(still, stillPosition, stillScale, axis, min2, max2);
+
+        const float d = glm::dot(displacement, axis);
+
+        if (d == 0.0f)
+        {
+            if (!(min1 < max2 && min2 < max1))
+            {
+                return false;
+            }
+            continue;
+        }
+
+        float t1 = (min2 - max1) / d;
+        float t2 = (max2 - min1) / d;
+
+        enter = std::max(enter, std::min(t1, t2));
+        exit = std::min(exit, std::max(t1, t2));
+
+        if (enter >= exit)
+        {
+            return false;
+        }
+    }
+
+    return true;
+}
+
+// Separating axis test between two hulls, the first one starting at movingPosition and moving by
+// displacement, the second one still. Returns the fraction of the move, in [0, 1], at which they
+// first overlap, or -1 if they never do. Scales must be positive
+inline float sweepHullTimeOfImpact(const ConvexHull &moving, glm::vec2 movingPosition, float movingScale,
+                                   const ConvexHull &still, glm::vec2 stillPosition, float stillScale,
+                                   glm::vec2 displacement)
+{
+    float enter = 0.0f;
+    float exit = 1.0f;
+
+    if (!sweepHullAxes(moving, moving, movingPosition, movingScale, still, stillPosition, stillScale, displacement, enter, exit) ||
+        !sweepHullAxes(still, moving, movingPosition, movingScale, still, stillPosition, stillScale, displacement, enter, exit))
+    {
+        return -1.0f;
+    }
+
+    return enter;
+}
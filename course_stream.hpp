@@ -0,0 +1,392 @@
+#pragma once
+
+#include <algorithm>
+#include <atomic>
+#include <chrono>
+#include <cmath>
+#include <cstdint>
+#include <thread>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "poisson_disk.hpp"
+#include "rng.hpp"
+#include "spsc_queue.hpp"
+
+// Chunks buffered by a CourseStream, generated ahead of the one in use
+const int COURSE_STREAM_CHUNKS = 8;
+
+// Chunks a SpawnTable keeps at hand, so that rolling back a little never regenerates one
+const int COURSE_CACHED_CHUNKS = 3;
+
+// How long the generator sleeps when all the buffered chunks are waiting to be used
+const std::chrono::milliseconds COURSE_STREAM_POLL_INTERVAL(1);
+
+// What a course looks like: each chunk is a Poisson disk pattern of length x width,
+// drawn from seed and its index only, so chunks can be generated in any order, on any thread
+struct CourseLayout
+{
+    uint64_t seed = 0;
+    float radius = 1.0f;
+    float length = 1.0f;
+    float width = 1.0f;
+};
+
+// Spawn points of one stretch of the course, sorted by decreasing x in [0, length)
+struct CourseChunk
+{
+    long index = -1;
+    std::vector<float> xs;
+    std::vector<float> zs;
+
+    void reserve(int capacity)
+    {
+        xs.reserve(capacity);
+        zs.reserve(capacity);
+    }
+};
+
+class CourseGenerator
+{
+    CourseLayout layout;
+    PoissonDiskScratch scratch;
+
+public:
+    void init(const CourseLayout &courseLayout)
+    {
+        layout = courseLayout;
+    }
+
+    const CourseLayout &getLayout() const
+    {
+        return layout;
+    }
+
+    int capacity() const
+    {
+        return poissonDiskCapacity(layout.radius, layout.length, layout.width);
+    }
+
+    // Sizes the working memory, so that generating never allocates
+    void reserve()
+    {
+        scratch.reserve(capacity(), layout.radius);
+    }
+
+    // The pattern wraps along X: the points closer than radius to the start of the chunk are
+    // dropped, so that they stay radius apart from the end of the next one, whatever it holds
+    void generate(long index, CourseChunk &chunk)
+    {
+        uint64_t state = layout.seed ^ (static_cast<uint64_t>(index) * 0xD1B54A32D192ED03ull);
+        RngStream random;
+        random.seed(splitMix64(state));
+
+        generatePoissonDisk(layout.radius, layout.length, layout.width, [&random](float min, float max)
+                            { return random.uniform(min, max); },
+                            chunk.xs, chunk.zs, scratch);
+
+        size_t n = chunk.xs.size();
+        while (n > 0 && chunk.xs[n - 1] < layout.radius)
+        {
+            n--;
+        }
+        chunk.xs.resize(n);
+        chunk.zs.resize(n);
+
+        chunk.index = index;
+    }
+};
+
+// Generates the chunks of a course on a background thread, in order, ahead of the game.
+// Chunks are handed over through one lock-free queue and come back through another once
+// copied, so that the game never waits for the generator nor the generator allocates.
+// Serves a single consumer
+class CourseStream
+{
+    CourseGenerator generator;
+    CourseChunk chunks[COURSE_STREAM_CHUNKS];
+
+    SpscQueue<CourseChunk *, COURSE_STREAM_CHUNKS> ready;
+    SpscQueue<CourseChunk *, COURSE_STREAM_CHUNKS> free;
+
+    // First chunk the consumer still needs, so that the generator can skip ahead
+    std::atomic<long> wanted{0};
+
+    std::atomic<bool> stopping{false};
+    std::thread worker;
+
+    void generateLoop()
+    {
+        long nextIndex = 0;
+
+        while (!stopping.load(std::memory_order_acquire))
+        {
+            CourseChunk *chunk;
+            if (!free.pop(chunk))
+            {
+                std::this_thread::sleep_for(COURSE_STREAM_POLL_INTERVAL);
+                continue;
+            }
+
+            nextIndex = std::max(nextIndex, wanted.load(std::memory_order_relaxed));
+            generator.generate(nextIndex++, *chunk);
+            ready.push(chunk);
+        }
+    }
+
+public:
+    CourseStream() = default;
+
+    CourseStream(const CourseStream &) = delete;
+    CourseStream &operator=(const CourseStream &) = delete;
+
+    ~CourseStream()
+    {
+        stop();
+    }
+
+    // (Re)starts generating the course from chunk 0
+    void start(const CourseLayout &layout)
+    {
+        stop();
+
+        generator.init(layout);
+        generator.reserve();
+        ready.clear();
+        free.clear();
+
+        for (auto &chunk : chunks)
+        {
+            chunk.reserve(generator.capacity());
+            free.push(&chunk);
+        }
+
+        wanted.store(0, std::memory_order_relaxed);
+        stopping.store(false, std::memory_order_relaxed);
+        worker = std::thread([this]
+                             { generateLoop(); });
+    }
+
+    void stop()
+    {
+        if (worker.joinable())
+        {
+            stopping.store(true, std::memory_order_release);
+            worker.join();
+        }
+    }
+
+    // Copies chunk index into out if it is ready, retiring the chunks before it.
+    // False if the generator has not got there yet, or is already past it
+    bool take(long index, CourseChunk &out)
+    {
+        wanted.store(index, std::memory_order_relaxed);
+
+        while (const auto front = ready.front())
+        {
+            CourseChunk *chunk = *front;
+
+            if (chunk->index > index)
+            {
+                return false;
+            }
+
+            const bool found = chunk->index == index;
+            if (found)
+            {
+                out.xs.assign(chunk->xs.begin(), chunk->xs.end());
+                out.zs.assign(chunk->zs.begin(), chunk->zs.end());
+                out.index = index;
+            }
+
+            ready.pop(chunk);
+            free.push(chunk);
+
+            if (found)
+            {
+                return true;
+            }
+        }
+
+        return false;
+    }
+};
+
+// Where a SpawnTable stands: chunk and point of the next spawn, and pattern origin
+struct SpawnTableCursor
+{
+    long chunk;
+    int cursor;
+    double originX;
+    double originZ;
+};
+
+// Rock spawn positions taken in order from a course made of chunks laid one behind the other
+// along X, moving with the rocks, never repeating. Along Z the course wraps onto
+// [minZ, minZ + width). Every rock sits on a different point of the course, so any two rocks are
+// always at least the course radius apart along X or Z. Points that crossed the entry line
+// without being used are skipped: when rocks leave faster than points arrive, the new ones queue
+// up behind the line instead of overlapping.
+// Chunks come from a CourseStream when there is one, else they are generated when reached;
+// either way the course only depends on its layout, and memory stays the same however long it is
+class SpawnTable
+{
+    CourseGenerator generator;
+    CourseStream *stream = nullptr;
+
+    CourseChunk cache[COURSE_CACHED_CHUNKS];
+    int current = 0;
+    int replaced = 0;
+
+    float minZ = 0.0f;
+
+    long chunk = -1;
+    int cursor = 0;
+
+    // World position of the origin of the current chunk
+    double originX = 0.0;
+    double originZ = 0.0;
+
+    float worldX(int i) const
+    {
+        return static_cast<float>(originX + cache[current].xs[i]);
+    }
+
+    // Makes chunk index the current one
+    void load(long index)
+    {
+        for (int c = 0; c < COURSE_CACHED_CHUNKS; ++c)
+        {
+            if (cache[c].index == index)
+            {
+                current = c;
+                return;
+            }
+        }
+
+        // Oldest chunk out, never the current one
+        if (replaced == current)
+        {
+            replaced = (replaced + 1) % COURSE_CACHED_CHUNKS;
+        }
+        current = replaced;
+        replaced = (replaced + 1) % COURSE_CACHED_CHUNKS;
+
+        if (stream == nullptr || !stream->take(index, cache[current]))
+        {
+            generator.generate(index, cache[current]);
+        }
+    }
+
+public:
+    // Sets up the course, with optional background generation; the first spawn starts chunk 0
+    void init(const CourseLayout &layout, float patternMinZ, CourseStream *courseStream = nullptr)
+    {
+        generator.init(layout);
+        stream = courseStream;
+        minZ = patternMinZ;
+
+        for (auto &entry : cache)
+        {
+            entry.index = -1;
+        }
+        reserve();
+        current = 0;
+        replaced = 0;
+
+        chunk = -1;
+        cursor = 0;
+
+        if (stream != nullptr)
+        {
+            stream->start(layout);
+        }
+    }
+
+    // Sizes the cached chunks and the generator for the largest chunk. Copies of a SpawnTable
+    // only keep the sizes of their vectors, so they need this before they stop allocating
+    void reserve()
+    {
+        for (auto &entry : cache)
+        {
+            entry.reserve(generator.capacity());
+        }
+        generator.reserve();
+    }
+
+    // Generates the chunks in place from now on, e.g. in a copy that must not share the stream
+    void detachStream()
+    {
+        stream = nullptr;
+    }
+
+    // First chunk never used yet
+    long nextChunk() const
+    {
+        return chunk + 1;
+    }
+
+    // Lays chunk index so that its first point is at (frontX, its Z shifted by offsetZ)
+    // and the next spawn takes it
+    void start(long index, float frontX, float offsetZ)
+    {
+        chunk = index;
+        load(chunk);
+
+        cursor = 0;
+        originX = frontX - cache[current].xs[0];
+        originZ = offsetZ;
+    }
+
+    SpawnTableCursor getCursor() const
+    {
+        return {chunk, cursor, originX, originZ};
+    }
+
+    void setCursor(const SpawnTableCursor &position)
+    {
+        chunk = position.chunk;
+        cursor = position.cursor;
+        originX = position.originX;
+        originZ = position.originZ;
+
+        if (chunk >= 0)
+        {
+            load(chunk);
+        }
+    }
+
+    // The rocks, and so the course, moved by (dx, dz)
+    void shift(float dx, float dz)
+    {
+        originX += dx;
+        originZ += dz;
+    }
+
+    // Next spawn position at or behind entryX
+    glm::vec2 next(float entryX)
+    {
+        while (worldX(cursor) > entryX)
+        {
+            advance();
+        }
+
+        const float width = generator.getLayout().width;
+        float z = std::fmod(static_cast<float>(cache[current].zs[cursor] + originZ - minZ), width);
+        glm::vec2 position = glm::vec2(worldX(cursor), minZ + (z < 0.0f ? z + width : z));
+        advance();
+
+        return position;
+    }
+
+    void advance()
+    {
+        if (++cursor == static_cast<int>(cache[current].xs.size()))
+        {
+            load(++chunk);
+            cursor = 0;
+            originX -= generator.getLayout().length;
+        }
+    }
+};
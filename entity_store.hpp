@@ -0,0 +1,128 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+// Components an entity can have, one bit each
+enum EntityComponent : unsigned
+{
+    TransformComponent = 1u << 0,
+    RenderComponent = 1u << 1,
+
+    // Rendered with a single instanced draw: the archetype takes one render handle for all its
+    // entities, and their model matrices come from an instance buffer instead of transforms
+    InstancedComponent = 1u << 2
+};
+
+struct Transform
+{
+    glm::vec3 position;
+    glm::vec3 rotation;
+    glm::vec3 scale;
+};
+
+// Entities with the same components, each component in its own contiguous array indexed by
+// the entity slot, so that a system reads the arrays it needs and nothing else.
+// A component the archetype does not have keeps its array empty
+struct Archetype
+{
+    unsigned components = 0;
+
+    // Mesh all the entities are drawn with, if they are rendered
+    int mesh = -1;
+
+    int count = 0;
+
+    std::vector<Transform> transforms;
+
+    // Index of the render resources (e.g. uniform buffers) of each entity, kept by the renderer.
+    // Instanced archetypes have a single one, shared by all their entities
+    std::vector<int> renderHandles;
+
+    bool has(unsigned mask) const
+    {
+        return (components & mask) == mask;
+    }
+};
+
+// Entities grouped by archetype. Systems visit the archetypes that have the components they
+// work on and skip the others whole, so that a new kind of entity does not slow down the loops
+// that do not care about it. Archetypes and entities are only added while setting up
+class EntityStore
+{
+    std::vector<Archetype> archetypes;
+
+    int renderHandles = 0;
+
+public:
+    int addArchetype(unsigned components, int mesh = -1)
+    {
+        Archetype archetype;
+        archetype.components = components;
+        archetype.mesh = mesh;
+
+        if (archetype.has(RenderComponent | InstancedComponent))
+        {
+            archetype.renderHandles.push_back(renderHandles++);
+        }
+
+        archetypes.push_back(archetype);
+
+        return archetypes.size() - 1;
+    }
+
+    Archetype &get(int archetype)
+    {
+        return archetypes[archetype];
+    }
+
+    // Adds an entity to archetype, rendered ones take the next render handle unless instanced;
+    // returns its slot
+    int addEntity(int archetype, const Transform &transform)
+    {
+        Archetype &entities = archetypes[archetype];
+
+        if (entities.has(TransformComponent))
+        {
+            entities.transforms.push_back(transform);
+        }
+        if (entities.has(RenderComponent) && !entities.has(InstancedComponent))
+        {
+            entities.renderHandles.push_back(renderHandles++);
+        }
+
+        return entities.count++;
+    }
+
+    // Render handles given out, from 0
+    int renderCount() const
+    {
+        return renderHandles;
+    }
+
+    // Calls system on every archetype that has all the components in mask
+    template <typename System>
+    void forEach(unsigned mask, System &&system)
+    {
+        for (auto &archetype : archetypes)
+        {
+            if (archetype.has(mask))
+            {
+                system(archetype);
+            }
+        }
+    }
+
+    template <typename System>
+    void forEach(unsigned mask, System &&system) const
+    {
+        for (const auto &archetype : archetypes)
+        {
+            if (archetype.has(mask))
+            {
+                system(archetype);
+            }
+        }
+    }
+};
@@ -0,0 +1,704 @@
+#pragma once
+
+#include <glm/glm.hpp>
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+#include <tuple>
+#include <algorithm>
+#include <cstring>
+#include <stdexcept>
+#include <type_traits>
+
+#include "collision_box.hpp"
+#include "rock_field.hpp"
+#include "collision_obb.hpp"
+#include "convex_hull.hpp"
+#include "course_stream.hpp"
+#include "sweep_and_prune.hpp"
+#include "rng.hpp"
+#include "stage_timings.hpp"
+#include "thread_pool.hpp"
+
+const int ROCK1_NUMBER = 6;
+const int ROCK2_NUMBER = 6;
+
+const float BOAT_DEFAULT_SCALE = 0.0012f;
+const float ROCK1_DEFAULT_SCALE = 0.15f;
+const float ROCK2_DEFAULT_SCALE = 0.25f;
+
+const glm::vec3 BOAT_INIT_POS = glm::vec3(2.5f, -0.1f, 0.0f);
+
+const float MIN_X = -35.0f;
+const float SPAWN_LIMIT_X = -20.0f;
+const float MAX_X = 3.25f;
+
+const float MIN_Z = -10.0f;
+const float MAX_Z = 10.0f;
+
+const float HORIZONTAL_SPEED = 1.8f;
+
+// Boat yaw while steering, in degrees
+const float BOAT_TURN_ANGLE = 20.0f;
+const float VERTICAL_SPEED = 5.0f;
+const float VERTICAL_SPEED_INCREMENT = 0.05f;
+
+const float OCEAN_SPEED = 0.6f;
+const float OCEAN_SPEED_INCREMENT = 0.0025f;
+const glm::vec3 OCEAN_INIT_POS = glm::vec3(-30.0f, -0.13f, -24.0f);
+
+// Length of the course chunks, generated ahead of the boat
+const float COURSE_CHUNK_LENGTH = 64.0f;
+
+const float MIN_ROCK_DISTANCE = 0.7f;
+const float SPAWN_JITTER = 0.1f;
+const float ROCK_SCALE_RANGE = 0.4f;
+
+const int WIN_POINTS = 200;
+
+const int PARALLEL_MIN_ROCKS = 16384;
+const int PARALLEL_CHUNK_ROCKS = 4096;
+
+const double SIM_RATE = 240.0;
+const double SIM_STEP = 1.0 / SIM_RATE;
+const int MAX_STEPS_PER_FRAME = 24;
+
+struct Game
+{
+    bool started = false;
+    int points = 0;
+    int highscore = 0;
+};
+
+// Outcome of a single simulation step
+enum GameEvent
+{
+    Playing,
+    Win,
+    Lose
+};
+
+// A boat over the last step: where it ended up, its yaw, and how far the rocks moved relative to it
+struct BoatPose
+{
+    glm::vec2 position;
+    float yaw;
+    glm::vec2 displacement;
+};
+
+// Without a hull, collisions use the boundaries box alone
+struct RockKind
+{
+    float defaultScale;
+    ModelBoundaries boundaries;
+    ConvexHull hull;
+};
+
+// Consumes variable frame times as a whole number of fixed simulation steps,
+// so that the game evolves the same way at any frame rate
+struct FixedTimestep
+{
+    double accumulator = 0.0;
+
+    // Returns how many steps to simulate for a frame lasting delta seconds.
+    // Time beyond MAX_STEPS_PER_FRAME is dropped to bound the cost of a hitch
+    int advance(double delta)
+    {
+        accumulator += delta;
+
+        int steps = static_cast<int>(accumulator / SIM_STEP);
+
+        if (steps > MAX_STEPS_PER_FRAME)
+        {
+            steps = MAX_STEPS_PER_FRAME;
+            accumulator = 0.0;
+        }
+        else
+        {
+            accumulator -= steps * SIM_STEP;
+        }
+
+        return steps;
+    }
+
+    // Fraction of a step between the last two simulated states
+    float alpha() const
+    {
+        return static_cast<float>(accumulator / SIM_STEP);
+    }
+
+    void reset()
+    {
+        accumulator = 0.0;
+    }
+};
+
+// Everything that changes while a GameCore plays, apart from its rocks
+struct GameCoreState
+{
+    Game game;
+
+    glm::vec3 boatRotation;
+    glm::vec3 previousBoatRotation;
+    glm::vec3 oceanPosition;
+    glm::vec3 previousOceanPosition;
+
+    glm::vec2 stepDisplacement;
+
+    SpawnTableCursor spawnCursor;
+    SweepAndPruneRing rockRing;
+
+    Rng rng;
+};
+
+static_assert(std::is_trivially_copyable<GameCoreState>::value, "GameCoreState must stay plain data");
+
+// Copy of a game, to roll back to or to search ahead from. It holds plain data only,
+// and the rock arrays as the single block they take in the RockField, so that taking
+// and restoring it are a few memcpy of a few KB; once sized, it never allocates again.
+// It can only be restored into the GameCore it was taken from, or one set up the same way
+struct GameSnapshot
+{
+    GameCoreState state;
+
+    int rockCount = 0;
+    std::vector<float> rockColumns;
+    std::vector<int> rockKinds;
+};
+
+// FNV-1a over the bits of n floats
+inline uint64_t hashFloats(uint64_t hash, const float *values, int n)
+{
+    for (int i = 0; i < n; ++i)
+    {
+        uint32_t bits;
+        std::memcpy(&bits, &values[i], sizeof(bits));
+
+        hash = (hash ^ bits) * 0x100000001B3ull;
+    }
+
+    return hash;
+}
+
+// Game logic without any window or Vulkan dependency:
+// it can be stepped both by BoatRunner and by a plain headless loop
+class GameCore
+{
+public:
+    Game game;
+
+    glm::vec3 boatPosition = BOAT_INIT_POS;
+    glm::vec3 boatRotation = glm::vec3(0.0f);
+    glm::vec3 previousBoatRotation = glm::vec3(0.0f);
+    float boatScale = BOAT_DEFAULT_SCALE;
+    ModelBoundaries boatBoundaries;
+    ConvexHull boatHull;
+
+    // Boat hull in world orientation, for turnedBoatHullYaw
+    ConvexHull turnedBoatHull;
+    float turnedBoatHullYaw = 0.0f;
+
+    glm::vec3 oceanPosition = OCEAN_INIT_POS;
+    glm::vec3 previousOceanPosition = OCEAN_INIT_POS;
+
+    // How far every rock moved in the last step
+    glm::vec2 stepDisplacement = glm::vec2(0.0f);
+
+    std::vector<RockKind> rockKinds;
+    RockField rocks;
+
+    // Rock spawn positions, along a course generated chunk by chunk
+    SpawnTable spawnTable;
+
+    // Optional generator of the course chunks ahead, not owned. One per GameCore
+    CourseStream *courseStream = nullptr;
+
+    // Set before init for stress runs: widens the course along Z until the whole field fits
+    // between MIN_X and SPAWN_LIMIT_X at the rock spacing, instead of stretching along X far
+    // behind the boat. Every rock then comes by the boat, so collisions and respawns grow with the field
+    bool denseCourse = false;
+
+    // Width of the course along Z, centered on the boat lane; set by init
+    float courseWidth = MAX_Z - MIN_Z;
+
+    // Rock slots kept sorted along X, to only test the rocks near the boat
+    SweepAndPrune rockOrder;
+
+    // Boat against rocks hit bits of the last range checked, one byte per 8 rocks
+    std::vector<uint8_t> hitMasks;
+
+    // Optional workers for large rock fields, not owned
+    ThreadPool *pool = nullptr;
+    std::vector<int> chunkResults;
+
+    // Optional time spent per stage, not owned. One per GameCore
+    StageTimings *timings = nullptr;
+
+    Rng rng;
+
+    // Random draws for a full respawn, filled in batch
+    std::vector<float> spawnJitters;
+    std::vector<float> spawnScaleOffsets;
+
+    // Rocks are stored kind by kind, in the order the kinds were added.
+    // The same seed and the same steering inputs always give the same game
+    void init(uint64_t seed, const ModelBoundaries &boat, const std::vector<RockKind> &kinds, const std::vector<int> &counts,
+              const ConvexHull &boatShape = ConvexHull())
+    {
+        rng.seed(seed);
+
+        boatBoundaries = boat;
+        boatHull = boatShape;
+        turnedBoatHull.clear();
+        rockKinds = kinds;
+        rocks.clear();
+
+        int total = 0;
+        for (int count : counts)
+        {
+            total += count;
+        }
+        rocks.reserve(total);
+        courseWidth = denseCourse ? getDenseCourseWidth(total) : MAX_Z - MIN_Z;
+
+        CourseLayout layout;
+        const uint64_t seedHigh = rng.positions.next();
+        const uint64_t seedLow = rng.positions.next();
+        layout.seed = seedHigh << 32 | seedLow;
+        layout.radius = getSpawnRadius(total);
+        layout.length = COURSE_CHUNK_LENGTH;
+        layout.width = courseWidth;
+        spawnTable.init(layout, 0.5f * (MIN_Z + MAX_Z - courseWidth), courseStream);
+        reserveScratch();
+
+        for (size_t k = 0; k < kinds.size(); ++k)
+        {
+            for (int i = 0; i < counts[k]; ++i)
+            {
+                rocks.add(k, MIN_X, 0.0f, kinds[k].defaultScale, kinds[k].boundaries);
+            }
+        }
+
+        spawnAllRocks();
+
+        game.points = 0;
+        game.started = true;
+    }
+
+    // Sizes the working memory for the whole field, so that stepping never allocates.
+    // Copies of a GameCore only keep the sizes of their vectors, so they need this too
+    void reserveScratch()
+    {
+        const int total = rocks.getCapacity();
+
+        hitMasks.reserve((total + 7) / 8);
+        chunkResults.reserve((total + PARALLEL_CHUNK_ROCKS - 1) / PARALLEL_CHUNK_ROCKS);
+        turnedBoatHull.reserve(boatHull.size());
+        spawnTable.reserve();
+    }
+
+    // Smallest spacing, along X or Z, between two rock positions: MIN_ROCK_DISTANCE,
+    // and enough for the boxes of two rocks at maximum scale not to overlap
+    float getRockSpacing() const
+    {
+        float maxExtent = 0.0f;
+
+        for (const auto &kind : rockKinds)
+        {
+            const ModelBoundaries &b = kind.boundaries;
+            float extent = std::max(std::max(b.minX, b.maxX), std::max(b.minZ, b.maxZ));
+            maxExtent = std::max(maxExtent, extent * kind.defaultScale * (1.0f + ROCK_SCALE_RANGE));
+        }
+
+        return std::max(MIN_ROCK_DISTANCE, 2.0f * maxExtent) * 1.01f;
+    }
+
+    // Radius of the spawn pattern: wide enough for the rocks to fill the band between MIN_X
+    // and SPAWN_LIMIT_X, as the uniform spawns did, never below the rock spacing.
+    // Z jitter is taken out of the spacing, so that it can never bring two rocks closer than that
+    float getSpawnRadius(int rockCount) const
+    {
+        float band = (SPAWN_LIMIT_X - MIN_X) * courseWidth;
+        float spread = std::sqrt(POISSON_DISK_DENSITY * band / std::max(rockCount, 1));
+
+        return std::max(getRockSpacing() + 2.0f * SPAWN_JITTER, spread);
+    }
+
+    // Width of a course holding rockCount rocks between MIN_X and SPAWN_LIMIT_X at the smallest
+    // spawn radius, never below the default one
+    float getDenseCourseWidth(int rockCount) const
+    {
+        float radius = getRockSpacing() + 2.0f * SPAWN_JITTER;
+        float width = rockCount * radius * radius / (POISSON_DISK_DENSITY * (SPAWN_LIMIT_X - MIN_X));
+
+        return std::max(MAX_Z - MIN_Z, width);
+    }
+
+    // Generates position and scale for a rock of the given kind, from the spawn table:
+    // at MIN_X on respawn, else from SPAWN_LIMIT_X backwards.
+    // jitter is a Z offset within SPAWN_JITTER, scaleOffset a fraction of the default scale within ROCK_SCALE_RANGE
+    std::tuple<glm::vec3, float> generateRockSpawn(int kind, bool respawn, float jitter, float scaleOffset)
+    {
+        glm::vec2 position = spawnTable.next(respawn ? MIN_X : SPAWN_LIMIT_X);
+        float scale = rockKinds[kind].defaultScale * (1.0f + scaleOffset);
+
+        return std::make_tuple(glm::vec3(position.x, ROCK_Y, position.y + jitter), scale);
+    }
+
+    // Places all the rocks from the start of a new stretch of course, front at SPAWN_LIMIT_X
+    void spawnAllRocks()
+    {
+        StageTimer timer(timings, StageSpawn);
+        const int n = rocks.size();
+
+        spawnTable.start(spawnTable.nextChunk(), SPAWN_LIMIT_X, rng.positions.uniform(0.0f, courseWidth));
+
+        spawnJitters.resize(n);
+        spawnScaleOffsets.resize(n);
+        rng.positions.fill(spawnJitters.data(), n, -SPAWN_JITTER, SPAWN_JITTER);
+        rng.scales.fill(spawnScaleOffsets.data(), n, -ROCK_SCALE_RANGE, ROCK_SCALE_RANGE);
+
+        for (int i = 0; i < n; ++i)
+        {
+            placeRock(i, false, spawnJitters[i], spawnScaleOffsets[i]);
+        }
+
+        rockOrder.build(rocks);
+    }
+
+    // Moves rock i to the next spawn position
+    void placeRock(int i, bool respawn, float jitter, float scaleOffset)
+    {
+        glm::vec3 position;
+        float scale;
+
+        std::tie(position, scale) = generateRockSpawn(rocks.kind[i], respawn, jitter, scaleOffset);
+        rocks.place(i, position.x, position.z, scale, rockKinds[rocks.kind[i]].boundaries);
+    }
+
+    void respawnRock(int i)
+    {
+        placeRock(i, true,
+                  rng.positions.uniform(-SPAWN_JITTER, SPAWN_JITTER),
+                  rng.scales.uniform(-ROCK_SCALE_RANGE, ROCK_SCALE_RANGE));
+    }
+
+    bool runsInParallel(int count) const
+    {
+        return pool != nullptr && pool->size() > 1 && count >= PARALLEL_MIN_ROCKS;
+    }
+
+    // Moves all the rocks, in chunks over the pool for large fields.
+    // Returns how many passed MAX_X
+    int integrateRocks(float dx, float dz)
+    {
+        const int n = rocks.size();
+
+        if (!runsInParallel(n))
+        {
+            return rocks.integrate(0, n, dx, dz, MAX_X);
+        }
+
+        const int chunks = (n + PARALLEL_CHUNK_ROCKS - 1) / PARALLEL_CHUNK_ROCKS;
+        chunkResults.resize(chunks);
+
+        auto task = [&](int c)
+        {
+            const int first = c * PARALLEL_CHUNK_ROCKS;
+            chunkResults[c] = rocks.integrate(first, std::min(PARALLEL_CHUNK_ROCKS, n - first), dx, dz, MAX_X);
+        };
+        pool->run(chunks, task);
+
+        int passed = 0;
+        for (int c = 0; c < chunks; ++c)
+        {
+            passed += chunkResults[c];
+        }
+
+        return passed;
+    }
+
+    // Tests the rocks [first, first + count) against the swept boat box, in chunks over the pool for large ranges
+    int collideRocks(int first, int count, const ObbSweep &sweep)
+    {
+        const ObbBatchKernel kernel = getObbBatchKernel();
+        hitMasks.resize((count + 7) / 8);
+
+        if (!runsInParallel(count))
+        {
+            return kernel(rocks.x + first, rocks.z + first,
+                          rocks.minX + first, rocks.maxX + first,
+                          rocks.minZ + first, rocks.maxZ + first,
+                          count, sweep, hitMasks.data());
+        }
+
+        const int chunks = (count + PARALLEL_CHUNK_ROCKS - 1) / PARALLEL_CHUNK_ROCKS;
+        chunkResults.resize(chunks);
+
+        auto task = [&](int c)
+        {
+            const int offset = c * PARALLEL_CHUNK_ROCKS;
+            const int start = first + offset;
+            chunkResults[c] = kernel(rocks.x + start, rocks.z + start,
+                                     rocks.minX + start, rocks.maxX + start,
+                                     rocks.minZ + start, rocks.maxZ + start,
+                                     std::min(PARALLEL_CHUNK_ROCKS, count - offset), sweep, hitMasks.data() + offset / 8);
+        };
+        pool->run(chunks, task);
+
+        int hits = 0;
+        for (int c = 0; c < chunks; ++c)
+        {
+            hits += chunkResults[c];
+        }
+
+        return hits;
+    }
+
+    void updateObjectsPositions(double delta, int horDir)
+    {
+        boatRotation.y = 0.0f - horDir * BOAT_TURN_ANGLE;
+
+        float dx = (VERTICAL_SPEED + VERTICAL_SPEED_INCREMENT * game.points) * delta;
+        float dz = horDir * HORIZONTAL_SPEED * delta;
+
+        int passed;
+        {
+            StageTimer timer(timings, StageIntegrate);
+            passed = integrateRocks(dx, dz);
+        }
+        spawnTable.shift(dx, dz);
+        stepDisplacement = glm::vec2(dx, dz);
+
+        // Respawn, the rocks past MAX_X are always at the front of the order.
+        // This stays serial, so that the spawns do not depend on the number of threads
+        if (passed > 0)
+        {
+            StageTimer timer(timings, StageRespawn);
+            for (int i = 0; i < passed; ++i)
+            {
+                respawnRock(rockOrder.front());
+                rockOrder.recycleFront(rocks);
+            }
+        }
+
+        oceanPosition.x += (OCEAN_SPEED + OCEAN_SPEED_INCREMENT) * delta;
+        oceanPosition.z += (OCEAN_SPEED + OCEAN_SPEED_INCREMENT) * delta;
+
+        game.points += passed;
+    }
+
+    // The boat of this game over the last step
+    BoatPose getBoatPose() const
+    {
+        return {glm::vec2(boatPosition.x, boatPosition.z), boatRotation.y, stepDisplacement};
+    }
+
+    // Boat box turned by the boat yaw
+    OrientedBox getBoatBox(const BoatPose &boat) const
+    {
+        return OrientedBox(boat.position, boat.yaw, boatScale, boatBoundaries);
+    }
+
+    // Narrowphase for rock i, whose box met the boat box along the last step:
+    // if both models have one, the convex hulls of the meshes
+    bool rockHitsBoat(int i, const BoatPose &boat, const OrientedBox &boatBox)
+    {
+        const ConvexHull &hull = rockKinds[rocks.kind[i]].hull;
+        if (hull.empty() || boatHull.empty())
+        {
+            return true;
+        }
+
+        // Boat hull turned and scaled, kept until the yaw changes
+        if (turnedBoatHull.size() != boatHull.size() || turnedBoatHullYaw != boat.yaw)
+        {
+            turnedBoatHull.resize(boatHull.size());
+            for (size_t p = 0; p < boatHull.size(); ++p)
+            {
+                turnedBoatHull[p] = boatBox.rotate(boatHull[p] * boatScale);
+            }
+            turnedBoatHullYaw = boat.yaw;
+        }
+
+        const glm::vec2 start = glm::vec2(rocks.x[i], rocks.z[i]) - boat.displacement;
+        return sweepHullTimeOfImpact(hull, start, rocks.scale[i],
+                                     turnedBoatHull, boat.position, 1.0f,
+                                     boat.displacement) >= 0.0f;
+    }
+
+    // Narrowphase of the rocks flagged in hitMasks for [first, first + count)
+    bool anyImpact(int first, int count, const BoatPose &boat, const OrientedBox &boatBox)
+    {
+        for (int block = 0; block * 8 < count; ++block)
+        {
+            for (uint8_t mask = hitMasks[block]; mask != 0; mask &= mask - 1)
+            {
+                if (rockHitsBoat(first + block * 8 + __builtin_ctz(mask), boat, boatBox))
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    }
+
+    // Continuous test over the last step, so that no rock can jump across the boat however long
+    // the step is, with the boat box turned by its yaw. All the rocks moved by the same displacement:
+    // the broadphase takes those whose X range met the box along it, the batch kernels run the
+    // separating axis test of each rock box against the boat box over the step, and only the rocks
+    // that hit get the narrowphase.
+    // Rocks respawned in the step did not move continuously, but they are far behind the boat.
+    // The broadphase order is kept up to date once per step, so any number of boats can query it
+    bool checkCollision(const BoatPose &boat)
+    {
+        StageTimer timer(timings, StageCollision);
+        OrientedBox boatBox = getBoatBox(boat);
+        ObbSweep sweep(boatBox, boat.displacement);
+        CollisionBox sweptBounds = boatBox.getBounds().sweep(boat.displacement);
+        bool hit = false;
+
+        rockOrder.forEachCandidateRange(rocks, sweptBounds.getMinX(), sweptBounds.getMaxX(), [&](int first, int count)
+                                        { hit = hit || (collideRocks(first, count, sweep) > 0 &&
+                                                        anyImpact(first, count, boat, boatBox)); });
+
+        return hit;
+    }
+
+    void saveSnapshot(GameSnapshot &snapshot) const
+    {
+        GameCoreState &state = snapshot.state;
+
+        state.game = game;
+        state.boatRotation = boatRotation;
+        state.previousBoatRotation = previousBoatRotation;
+        state.oceanPosition = oceanPosition;
+        state.previousOceanPosition = previousOceanPosition;
+        state.stepDisplacement = stepDisplacement;
+        state.spawnCursor = spawnTable.getCursor();
+        state.rockRing = rockOrder.getRing();
+        state.rng = rng;
+
+        snapshot.rockCount = rocks.size();
+        snapshot.rockColumns.resize(ROCK_COLUMNS * rocks.getCapacity());
+        snapshot.rockKinds.resize(rocks.size());
+
+        std::memcpy(snapshot.rockColumns.data(), rocks.x, snapshot.rockColumns.size() * sizeof(float));
+        std::memcpy(snapshot.rockKinds.data(), rocks.kind, snapshot.rockKinds.size() * sizeof(int));
+    }
+
+    // Restores the game in place: rocks keep their storage
+    void loadSnapshot(const GameSnapshot &snapshot)
+    {
+        if (snapshot.rockCount != rocks.size() ||
+            snapshot.rockColumns.size() != static_cast<size_t>(ROCK_COLUMNS * rocks.getCapacity()))
+        {
+            throw std::runtime_error("snapshot taken from a different rock field!");
+        }
+
+        const GameCoreState &state = snapshot.state;
+
+        game = state.game;
+        boatRotation = state.boatRotation;
+        previousBoatRotation = state.previousBoatRotation;
+        oceanPosition = state.oceanPosition;
+        previousOceanPosition = state.previousOceanPosition;
+        stepDisplacement = state.stepDisplacement;
+        spawnTable.setCursor(state.spawnCursor);
+        rockOrder.setRing(state.rockRing);
+        rng = state.rng;
+
+        std::memcpy(rocks.x, snapshot.rockColumns.data(), snapshot.rockColumns.size() * sizeof(float));
+        std::memcpy(rocks.kind, snapshot.rockKinds.data(), snapshot.rockKinds.size() * sizeof(int));
+    }
+
+    // Hash of everything the next steps depend on, to check that two runs stay identical
+    uint64_t stateHash() const
+    {
+        const float scalars[] = {boatRotation.y, oceanPosition.x, oceanPosition.z,
+                                 static_cast<float>(game.points), static_cast<float>(game.started)};
+
+        uint64_t hash = hashFloats(0xCBF29CE484222325ull, scalars, 5);
+        hash = hashFloats(hash, rocks.x, rocks.size());
+        hash = hashFloats(hash, rocks.z, rocks.size());
+        hash = hashFloats(hash, rocks.scale, rocks.size());
+
+        return hash;
+    }
+
+    // Keeps the current state as the start point of the render interpolation
+    void storePreviousState()
+    {
+        previousBoatRotation = boatRotation;
+        previousOceanPosition = oceanPosition;
+
+        rocks.storePrevious();
+    }
+
+    // Advances the game by delta seconds, steering in horDir (-1, 0, 1).
+    // Pass SIM_STEP to get reproducible games
+    GameEvent step(double delta, int horDir)
+    {
+        if (!game.started)
+        {
+            return Playing;
+        }
+
+        if (advance(delta, horDir) == Win)
+        {
+            return Win;
+        }
+
+        if (checkCollision(getBoatPose()))
+        {
+            endGame();
+            return Lose;
+        }
+
+        return Playing;
+    }
+
+    // Moves everything but tests no collision, so that the boats can be tested apart. Win once
+    // the points are reached
+    GameEvent advance(double delta, int horDir)
+    {
+        // Rocks keep their previous positions while they move
+        previousBoatRotation = boatRotation;
+        previousOceanPosition = oceanPosition;
+
+        updateObjectsPositions(delta, horDir);
+
+        if (game.points >= WIN_POINTS)
+        {
+            endGame();
+            return Win;
+        }
+
+        return Playing;
+    }
+
+    // The final state is shown as is, without interpolation
+    void endGame()
+    {
+        game.highscore = std::max(game.highscore, game.points);
+        game.started = false;
+
+        storePreviousState();
+    }
+
+    void restart()
+    {
+        boatRotation = glm::vec3(0.0f);
+
+        spawnAllRocks();
+
+        oceanPosition = OCEAN_INIT_POS;
+
+        storePreviousState();
+
+        game.points = 0;
+        game.started = true;
+    }
+};
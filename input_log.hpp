@@ -0,0 +1,263 @@
+#pragma once
+
+#include <cstdint>
+#include <fstream>
+#include <iterator>
+#include <stdexcept>
+#include <string>
+#include <vector>
+
+const uint32_t INPUT_LOG_MAGIC = 0x4c495242; // "BRIL"
+const uint32_t INPUT_LOG_VERSION = 2;
+
+// Steps between two state hash checkpoints
+const long INPUT_LOG_HASH_INTERVAL = 60;
+
+// Bytes reserved up front by a recording, enough for hours of play at the
+// usual run lengths, so that logging does not allocate during a session
+const size_t INPUT_LOG_RESERVE = 1 << 20;
+
+// Record tags, in the low 3 bits of each varint: tags 0 to 2 are runs of
+// steps steering -1, 0 and 1, their length in the upper bits
+enum InputLogTag
+{
+    TagSteerLeft,
+    TagSteerStraight,
+    TagSteerRight,
+    TagRestart,
+    TagHash,
+    TagEnd
+};
+
+// Folds the state hash of a step into the running hash of the session
+inline uint64_t chainStateHash(uint64_t chain, uint64_t stateHash)
+{
+    chain ^= stateHash + 0x9E3779B97F4A7C15ull + (chain << 6) + (chain >> 2);
+    return chain;
+}
+
+// Steering inputs and restarts of a session, with the seed and rock count of its game.
+// Simulation steps are logged, not rendered frames: runs of steps with the same steering
+// take a single varint, and every INPUT_LOG_HASH_INTERVAL steps the running hash of
+// the game state is stored, so that a replay can tell where it diverged
+class InputRecorder
+{
+    std::vector<uint8_t> bytes;
+
+    int runDirection = 0;
+    uint64_t runLength = 0;
+
+    long steps = 0;
+    uint64_t chain = 0;
+
+    void putVarint(uint64_t value)
+    {
+        while (value >= 0x80)
+        {
+            bytes.push_back(static_cast<uint8_t>(value | 0x80));
+            value >>= 7;
+        }
+        bytes.push_back(static_cast<uint8_t>(value));
+    }
+
+    void putRaw(uint64_t value, int size)
+    {
+        for (int i = 0; i < size; ++i)
+        {
+            bytes.push_back(static_cast<uint8_t>(value >> (8 * i)));
+        }
+    }
+
+    void flushRun()
+    {
+        if (runLength > 0)
+        {
+            putVarint(runLength << 3 | static_cast<uint64_t>(runDirection + 1));
+            runLength = 0;
+        }
+    }
+
+public:
+    // rocks is the size of the rock field, 0 for the default one
+    void start(uint64_t seed, int rocks = 0)
+    {
+        bytes.clear();
+        bytes.reserve(INPUT_LOG_RESERVE);
+        putRaw(INPUT_LOG_MAGIC, 4);
+        putRaw(INPUT_LOG_VERSION, 4);
+        putRaw(seed, 8);
+        putRaw(rocks, 4);
+
+        runLength = 0;
+        steps = 0;
+        chain = 0;
+    }
+
+    bool isStarted() const
+    {
+        return !bytes.empty();
+    }
+
+    // A simulation step steering in horDir, leaving the game in a state hashing to stateHash
+    void step(int horDir, uint64_t stateHash)
+    {
+        if (horDir != runDirection)
+        {
+            flushRun();
+            runDirection = horDir;
+        }
+        runLength++;
+
+        chain = chainStateHash(chain, stateHash);
+
+        if (++steps % INPUT_LOG_HASH_INTERVAL == 0)
+        {
+            flushRun();
+            putVarint(TagHash);
+            putRaw(chain, 8);
+        }
+    }
+
+    void restart()
+    {
+        flushRun();
+        putVarint(TagRestart);
+    }
+
+    long getSteps() const
+    {
+        return steps;
+    }
+
+    // Writes the log, ending it with the final hash
+    void save(const std::string &file)
+    {
+        flushRun();
+
+        // The end record is taken back, so that recording can go on
+        const size_t size = bytes.size();
+        putVarint(TagEnd);
+        putRaw(chain, 8);
+
+        std::ofstream out(file, std::ios::binary);
+        out.write(reinterpret_cast<const char *>(bytes.data()), bytes.size());
+        bytes.resize(size);
+
+        if (!out)
+        {
+            throw std::runtime_error("failed to write input log " + file + "!");
+        }
+    }
+};
+
+// Reads back a log written by InputRecorder, one record at a time
+class InputLogReader
+{
+    std::vector<uint8_t> bytes;
+    size_t position = 0;
+    bool finished = false;
+
+    uint64_t getVarint()
+    {
+        uint64_t value = 0;
+
+        for (int shift = 0; shift < 64; shift += 7)
+        {
+            if (position >= bytes.size())
+            {
+                throw std::runtime_error("truncated input log!");
+            }
+
+            uint8_t byte = bytes[position++];
+            value |= static_cast<uint64_t>(byte & 0x7f) << shift;
+
+            if (!(byte & 0x80))
+            {
+                return value;
+            }
+        }
+
+        throw std::runtime_error("corrupted input log!");
+    }
+
+    uint64_t getRaw(int size)
+    {
+        if (position + size > bytes.size())
+        {
+            throw std::runtime_error("truncated input log!");
+        }
+
+        uint64_t value = 0;
+        for (int i = 0; i < size; ++i)
+        {
+            value |= static_cast<uint64_t>(bytes[position++]) << (8 * i);
+        }
+
+        return value;
+    }
+
+public:
+    uint64_t seed = 0;
+
+    // Size of the rock field, 0 for the default one. Version 1 logs only played that one
+    int rocks = 0;
+
+    // Current record: tag, and run length or hash
+    InputLogTag tag = TagEnd;
+    uint64_t value = 0;
+
+    void load(const std::string &file)
+    {
+        std::ifstream in(file, std::ios::binary);
+        if (!in)
+        {
+            throw std::runtime_error("failed to open input log " + file + "!");
+        }
+
+        bytes.assign(std::istreambuf_iterator<char>(in), std::istreambuf_iterator<char>());
+        position = 0;
+
+        if (getRaw(4) != INPUT_LOG_MAGIC)
+        {
+            throw std::runtime_error(file + " is not a supported input log!");
+        }
+
+        const uint64_t version = getRaw(4);
+        if (version < 1 || version > INPUT_LOG_VERSION)
+        {
+            throw std::runtime_error(file + " is not a supported input log!");
+        }
+
+        seed = getRaw(8);
+        rocks = version >= 2 ? static_cast<int>(getRaw(4)) : 0;
+        finished = false;
+    }
+
+    // Reads the next record, false after the end one
+    bool next()
+    {
+        if (finished)
+        {
+            return false;
+        }
+
+        uint64_t record = getVarint();
+        tag = static_cast<InputLogTag>(record & 7);
+
+        if (tag <= TagSteerRight)
+        {
+            value = record >> 3;
+        }
+        else if (tag == TagHash || tag == TagEnd)
+        {
+            value = getRaw(8);
+            finished = tag == TagEnd;
+        }
+        else if (tag != TagRestart)
+        {
+            throw std::runtime_error("corrupted input log!");
+        }
+
+        return true;
+    }
+};
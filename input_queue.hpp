@@ -0,0 +1,81 @@
+#pragma once
+
+#include <algorithm>
+#include <chrono>
+
+#include "spsc_queue.hpp"
+
+// Key events buffered between the event thread and the simulation
+const size_t INPUT_QUEUE_EVENTS = 256;
+
+// Keys the game reacts to; several physical keys can map to the same one
+enum InputKey
+{
+    KeySteerLeft,
+    KeySteerRight,
+    KeyRestart,
+    INPUT_KEYS
+};
+
+struct InputEvent
+{
+    double time;
+    InputKey key;
+    bool pressed;
+};
+
+typedef SpscQueue<InputEvent, INPUT_QUEUE_EVENTS> InputQueue;
+
+// Seconds on the clock input events and frames are stamped with
+inline double inputClock()
+{
+    return std::chrono::duration<double>(std::chrono::steady_clock::now().time_since_epoch()).count();
+}
+
+// Keys held down, as of the last event applied. Events are applied in time order, each one
+// before the first simulation step starting after it, so that a key pressed in the middle of a
+// long frame steers from the right step instead of from the next frame
+struct InputState
+{
+    // Physical keys held for each game key
+    int held[INPUT_KEYS] = {};
+
+    void apply(const InputEvent &event)
+    {
+        held[event.key] = std::max(0, held[event.key] + (event.pressed ? 1 : -1));
+    }
+
+    // Applies the queued events stamped up to time, leaving the later ones queued
+    void applyUntil(InputQueue &queue, double time)
+    {
+        InputEvent event;
+
+        for (const InputEvent *next = queue.front(); next != nullptr && next->time <= time; next = queue.front())
+        {
+            queue.pop(event);
+            apply(event);
+        }
+    }
+
+    bool isHeld(InputKey key) const
+    {
+        return held[key] > 0;
+    }
+
+    // Steering: -1 left, 1 right, 0 straight; left wins when both are held
+    int horizontalDirection() const
+    {
+        if (isHeld(KeySteerLeft))
+        {
+            return -1;
+        }
+        else if (isHeld(KeySteerRight))
+        {
+            return 1;
+        }
+        else
+        {
+            return 0;
+        }
+    }
+};
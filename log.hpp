@@ -0,0 +1,374 @@
+#pragma once
+
+#include <atomic>
+#include <chrono>
+#include <cstdint>
+#include <cstring>
+#include <iostream>
+#include <string>
+#include <thread>
+#include <type_traits>
+
+// Asynchronous logging: callers only copy their arguments into a record of a lock-free ring,
+// and a background thread formats and writes them, so logging never waits on the terminal.
+// Messages below BOAT_RUNNER_LOG_LEVEL are stripped at compile time; build with
+// -DBOAT_RUNNER_LOG_LEVEL=4 to silence logging entirely, e.g. for benchmarks
+
+enum LogLevel
+{
+    LogDebug,
+    LogInfo,
+    LogWarning,
+    LogError,
+    LogOff
+};
+
+#ifndef BOAT_RUNNER_LOG_LEVEL
+#define BOAT_RUNNER_LOG_LEVEL 0
+#endif
+
+const LogLevel LOG_LEVEL = static_cast<LogLevel>(BOAT_RUNNER_LOG_LEVEL);
+
+// Records in the ring, a power of two, and payload bytes of each record: longer messages are truncated
+const size_t LOG_RING_RECORDS = 1024;
+const int LOG_RECORD_BYTES = 240;
+
+// How long the writer sleeps when the ring is empty
+const std::chrono::milliseconds LOG_POLL_INTERVAL(1);
+
+// Argument tags in the payload of a record
+enum LogArgument : uint8_t
+{
+    LogArgSigned,
+    LogArgUnsigned,
+    LogArgFloat,
+    LogArgText
+};
+
+struct LogRecord
+{
+    // Vyukov's bounded queue: equals the position of the record when free to write,
+    // the position + 1 once written, the position + LOG_RING_RECORDS once read
+    std::atomic<size_t> sequence;
+
+    LogLevel level;
+    int size;
+    bool truncated;
+    char payload[LOG_RECORD_BYTES];
+
+    void putBytes(LogArgument tag, const void *bytes, int count)
+    {
+        if (truncated || size + 1 + count > LOG_RECORD_BYTES)
+        {
+            truncated = true;
+            return;
+        }
+
+        payload[size++] = tag;
+        std::memcpy(payload + size, bytes, count);
+        size += count;
+    }
+
+    void putText(const char *text, size_t length)
+    {
+        // Text fits partially: keep as much as possible
+        const int room = LOG_RECORD_BYTES - size - 1 - static_cast<int>(sizeof(uint16_t));
+        if (truncated || room <= 0)
+        {
+            truncated = true;
+            return;
+        }
+
+        if (length > static_cast<size_t>(room))
+        {
+            length = room;
+            truncated = true;
+        }
+
+        const uint16_t count = static_cast<uint16_t>(length);
+        payload[size++] = LogArgText;
+        std::memcpy(payload + size, &count, sizeof(count));
+        std::memcpy(payload + size + sizeof(count), text, count);
+        size += sizeof(count) + count;
+    }
+
+    void put(const char *text)
+    {
+        putText(text, std::strlen(text));
+    }
+
+    void put(const std::string &text)
+    {
+        putText(text.data(), text.size());
+    }
+
+    void put(char c)
+    {
+        putText(&c, 1);
+    }
+
+    void put(bool value)
+    {
+        int64_t v = value;
+        putBytes(LogArgSigned, &v, sizeof(v));
+    }
+
+    template <typename T>
+    void put(T value)
+    {
+        static_assert(std::is_arithmetic<T>::value || std::is_enum<T>::value, "unsupported log argument");
+
+        if constexpr (std::is_floating_point<T>::value)
+        {
+            double v = value;
+            putBytes(LogArgFloat, &v, sizeof(v));
+        }
+        else if constexpr (std::is_enum<T>::value || std::is_signed<T>::value)
+        {
+            int64_t v = static_cast<int64_t>(value);
+            putBytes(LogArgSigned, &v, sizeof(v));
+        }
+        else
+        {
+            uint64_t v = value;
+            putBytes(LogArgUnsigned, &v, sizeof(v));
+        }
+    }
+
+    // Writes the arguments in order, as operator<< would, and ends the line
+    void format(std::ostream &out) const
+    {
+        int offset = 0;
+
+        while (offset < size)
+        {
+            const LogArgument tag = static_cast<LogArgument>(payload[offset++]);
+
+            if (tag == LogArgText)
+            {
+                uint16_t count;
+                std::memcpy(&count, payload + offset, sizeof(count));
+                out.write(payload + offset + sizeof(count), count);
+                offset += sizeof(count) + count;
+                continue;
+            }
+
+            char value[8];
+            std::memcpy(value, payload + offset, sizeof(value));
+            offset += sizeof(value);
+
+            if (tag == LogArgSigned)
+            {
+                int64_t v;
+                std::memcpy(&v, value, sizeof(v));
+                out << v;
+            }
+            else if (tag == LogArgUnsigned)
+            {
+                uint64_t v;
+                std::memcpy(&v, value, sizeof(v));
+                out << v;
+            }
+            else
+            {
+                double v;
+                std::memcpy(&v, value, sizeof(v));
+                out << v;
+            }
+        }
+
+        if (truncated)
+        {
+            out << "...";
+        }
+
+        out << '\n';
+    }
+};
+
+// Many producers, one writer thread. Producers never block: when the ring is full the
+// message is dropped and counted, and the writer reports how many were lost
+class Logger
+{
+    LogRecord records[LOG_RING_RECORDS];
+
+    std::atomic<size_t> enqueuePosition{0};
+    std::atomic<size_t> dequeuePosition{0};
+    std::atomic<unsigned long> dropped{0};
+
+    std::atomic<bool> stopping{false};
+    std::thread writer;
+
+    // Writes all the records available; false if there were none
+    bool drain()
+    {
+        size_t position = dequeuePosition.load(std::memory_order_relaxed);
+        bool wrote = false;
+
+        for (;;)
+        {
+            LogRecord &record = records[position & (LOG_RING_RECORDS - 1)];
+
+            if (record.sequence.load(std::memory_order_acquire) != position + 1)
+            {
+                break;
+            }
+
+            record.format(record.level >= LogWarning ? std::cerr : std::cout);
+            record.sequence.store(position + LOG_RING_RECORDS, std::memory_order_release);
+
+            dequeuePosition.store(++position, std::memory_order_release);
+            wrote = true;
+        }
+
+        unsigned long lost = dropped.exchange(0, std::memory_order_relaxed);
+        if (lost > 0)
+        {
+            std::cerr << lost << " log messages dropped\n";
+            wrote = true;
+        }
+
+        if (wrote)
+        {
+            std::cout.flush();
+            std::cerr.flush();
+        }
+
+        return wrote;
+    }
+
+    void writeLoop()
+    {
+        while (!stopping.load(std::memory_order_acquire))
+        {
+            if (!drain())
+            {
+                std::this_thread::sleep_for(LOG_POLL_INTERVAL);
+            }
+        }
+
+        drain();
+    }
+
+public:
+    Logger()
+    {
+        for (size_t i = 0; i < LOG_RING_RECORDS; ++i)
+        {
+            records[i].sequence.store(i, std::memory_order_relaxed);
+        }
+
+        writer = std::thread([this]
+                             { writeLoop(); });
+    }
+
+    ~Logger()
+    {
+        stopping.store(true, std::memory_order_release);
+        writer.join();
+    }
+
+    Logger(const Logger &) = delete;
+    Logger &operator=(const Logger &) = delete;
+
+    // Copies the arguments into a free record; false if the ring was full
+    template <typename... Args>
+    bool push(LogLevel level, const Args &...args)
+    {
+        size_t position = enqueuePosition.load(std::memory_order_relaxed);
+        LogRecord *record;
+
+        for (;;)
+        {
+            record = &records[position & (LOG_RING_RECORDS - 1)];
+            const intptr_t lag = static_cast<intptr_t>(record->sequence.load(std::memory_order_acquire) - position);
+
+            if (lag == 0)
+            {
+                if (enqueuePosition.compare_exchange_weak(position, position + 1, std::memory_order_relaxed))
+                {
+                    break;
+                }
+            }
+            else if (lag < 0)
+            {
+                dropped.fetch_add(1, std::memory_order_relaxed);
+                return false;
+            }
+            else
+            {
+                position = enqueuePosition.load(std::memory_order_relaxed);
+            }
+        }
+
+        record->level = level;
+        record->size = 0;
+        record->truncated = false;
+        (record->put(args), ...);
+
+        record->sequence.store(position + 1, std::memory_order_release);
+        return true;
+    }
+
+    // Waits until everything logged so far has been written, e.g. before printing results
+    void flush()
+    {
+        const size_t target = enqueuePosition.load(std::memory_order_acquire);
+
+        while (dequeuePosition.load(std::memory_order_acquire) < target)
+        {
+            std::this_thread::yield();
+        }
+    }
+};
+
+// The logger of the program, started on first use
+inline Logger &logger()
+{
+    static Logger instance;
+    return instance;
+}
+
+// Logs the concatenation of args, as std::cout << args... would, on its own line.
+// Arguments can be numbers, enums, characters, C strings and std::strings
+template <LogLevel level, typename... Args>
+inline void logMessage(const Args &...args)
+{
+    if constexpr (level >= LOG_LEVEL)
+    {
+        logger().push(level, args...);
+    }
+}
+
+template <typename... Args>
+inline void logDebug(const Args &...args)
+{
+    logMessage<LogDebug>(args...);
+}
+
+template <typename... Args>
+inline void logInfo(const Args &...args)
+{
+    logMessage<LogInfo>(args...);
+}
+
+template <typename... Args>
+inline void logWarning(const Args &...args)
+{
+    logMessage<LogWarning>(args...);
+}
+
+template <typename... Args>
+inline void logError(const Args &...args)
+{
+    logMessage<LogError>(args...);
+}
+
+// Waits for the pending messages to be written, if logging is compiled in
+inline void flushLog()
+{
+    if constexpr (LOG_LEVEL < LogOff)
+    {
+        logger().flush();
+    }
+}
@@ -0,0 +1,212 @@
+#pragma once
+
+#include <atomic>
+#include <cstdint>
+#include <cstring>
+#include <stdexcept>
+#include <string>
+
+#include <fcntl.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+#include <unistd.h>
+
+const uint64_t OBSERVATION_RING_MAGIC = 0x474e495254414f42ull;
+const size_t OBSERVATION_RING_ALIGNMENT = 64;
+
+// Fixed size records published by one process and read by others through POSIX shared memory.
+// The writer never waits: each slot carries a sequence number, odd while it is written,
+// and readers check it before and after copying, so a slot overwritten meanwhile is detected
+class ObservationRing
+{
+    struct Header
+    {
+        uint64_t magic;
+        uint64_t recordSize;
+        uint64_t slotSize;
+        uint64_t slotCount;
+        alignas(OBSERVATION_RING_ALIGNMENT) std::atomic<uint64_t> published;
+    };
+
+    struct Slot
+    {
+        alignas(OBSERVATION_RING_ALIGNMENT) std::atomic<uint64_t> sequence;
+    };
+
+    static_assert(std::atomic<uint64_t>::is_always_lock_free, "the ring needs lock free 64 bit atomics");
+
+    std::string name;
+    bool owner = false;
+
+    void *memory = nullptr;
+    size_t mappedSize = 0;
+    Header *header = nullptr;
+
+    static size_t alignUp(size_t size)
+    {
+        return (size + OBSERVATION_RING_ALIGNMENT - 1) / OBSERVATION_RING_ALIGNMENT * OBSERVATION_RING_ALIGNMENT;
+    }
+
+    Slot *slotAt(uint64_t index) const
+    {
+        char *base = static_cast<char *>(memory) + alignUp(sizeof(Header));
+        return reinterpret_cast<Slot *>(base + (index % header->slotCount) * header->slotSize);
+    }
+
+    void *recordOf(Slot *slot) const
+    {
+        return reinterpret_cast<char *>(slot) + sizeof(Slot);
+    }
+
+    void map(int fd, size_t size, const std::string &error)
+    {
+        memory = mmap(nullptr, size, PROT_READ | PROT_WRITE, MAP_SHARED, fd, 0);
+        close(fd);
+
+        if (memory == MAP_FAILED)
+        {
+            memory = nullptr;
+            throw std::runtime_error(error);
+        }
+
+        mappedSize = size;
+        header = static_cast<Header *>(memory);
+    }
+
+public:
+    ObservationRing() = default;
+    ObservationRing(const ObservationRing &) = delete;
+    ObservationRing &operator=(const ObservationRing &) = delete;
+
+    ~ObservationRing()
+    {
+        release();
+    }
+
+    bool isOpen() const
+    {
+        return memory != nullptr;
+    }
+
+    // Creates the ring, replacing any previous one with the same name
+    void create(const std::string &ringName, int slotCount, size_t recordSize)
+    {
+        release();
+
+        if (slotCount <= 0)
+        {
+            throw std::runtime_error("the ring needs at least one slot!");
+        }
+
+        const size_t slotSize = sizeof(Slot) + alignUp(recordSize);
+        const size_t size = alignUp(sizeof(Header)) + slotCount * slotSize;
+
+        shm_unlink(ringName.c_str());
+        int fd = shm_open(ringName.c_str(), O_CREAT | O_EXCL | O_RDWR, 0600);
+        if (fd < 0 || ftruncate(fd, size) != 0)
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            throw std::runtime_error("failed to create shared memory " + ringName + "!");
+        }
+
+        map(fd, size, "failed to map shared memory " + ringName + "!");
+        name = ringName;
+        owner = true;
+
+        // The new object is zero filled: only the layout needs to be written
+        header->recordSize = recordSize;
+        header->slotSize = slotSize;
+        header->slotCount = slotCount;
+        std::atomic_thread_fence(std::memory_order_release);
+        header->magic = OBSERVATION_RING_MAGIC;
+    }
+
+    // Opens a ring created by another process
+    void open(const std::string &ringName)
+    {
+        release();
+
+        int fd = shm_open(ringName.c_str(), O_RDWR, 0600);
+        struct stat info;
+        if (fd < 0 || fstat(fd, &info) != 0 || static_cast<size_t>(info.st_size) < sizeof(Header))
+        {
+            if (fd >= 0)
+            {
+                close(fd);
+            }
+            throw std::runtime_error("failed to open shared memory " + ringName + "!");
+        }
+
+        map(fd, info.st_size, "failed to map shared memory " + ringName + "!");
+        name = ringName;
+
+        if (header->magic != OBSERVATION_RING_MAGIC)
+        {
+            release();
+            throw std::runtime_error(ringName + " is not an observation ring!");
+        }
+    }
+
+    // Unmaps the ring, and removes it if it was created here
+    void release()
+    {
+        if (memory != nullptr)
+        {
+            munmap(memory, mappedSize);
+            if (owner)
+            {
+                shm_unlink(name.c_str());
+            }
+        }
+
+        memory = nullptr;
+        header = nullptr;
+        mappedSize = 0;
+        owner = false;
+    }
+
+    size_t recordSize() const
+    {
+        return header->recordSize;
+    }
+
+    uint64_t count() const
+    {
+        return header->published.load(std::memory_order_acquire);
+    }
+
+    // Writer side: copies a record of recordSize() bytes into the next slot
+    void publish(const void *record)
+    {
+        const uint64_t index = header->published.load(std::memory_order_relaxed);
+        Slot *slot = slotAt(index);
+
+        slot->sequence.store(2 * index + 1, std::memory_order_relaxed);
+        std::atomic_thread_fence(std::memory_order_release);
+
+        std::memcpy(recordOf(slot), record, header->recordSize);
+
+        slot->sequence.store(2 * index + 2, std::memory_order_release);
+        header->published.store(index + 1, std::memory_order_release);
+    }
+
+    // Reader side: copies record index into out, false if it is not there (yet or anymore)
+    bool read(uint64_t index, void *out) const
+    {
+        Slot *slot = slotAt(index);
+
+        const uint64_t before = slot->sequence.load(std::memory_order_acquire);
+        if (before != 2 * index + 2)
+        {
+            return false;
+        }
+
+        std::memcpy(out, recordOf(slot), header->recordSize);
+
+        std::atomic_thread_fence(std::memory_order_acquire);
+        return slot->sequence.load(std::memory_order_relaxed) == before;
+    }
+};
@@ -0,0 +1,160 @@
+#pragma once
+
+#include <algorithm>
+#include <cmath>
+#include <numeric>
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "spatial_hash.hpp"
+
+const int POISSON_DISK_ATTEMPTS = 30;
+// Points generatePoissonDisk places on average per radius x radius area
+const float POISSON_DISK_DENSITY = 0.5f;
+
+// Working memory of generatePoissonDisk, kept between calls so that they stop allocating
+struct PoissonDiskScratch
+{
+    SpatialHash grid;
+    std::vector<int> active;
+    std::vector<int> order;
+    std::vector<float> sortedX;
+    std::vector<float> sortedZ;
+
+    // Sizes everything for capacity points at radius; the grid is also emptied
+    void reserve(int capacity, float radius)
+    {
+        grid.init(capacity, radius);
+        active.reserve(capacity);
+        order.reserve(capacity);
+        sortedX.reserve(capacity);
+        sortedZ.reserve(capacity);
+    }
+};
+
+// Most points generatePoissonDisk can return
+inline int poissonDiskCapacity(float radius, float length, float width)
+{
+    return static_cast<int>(1.2f * length * width / (radius * radius)) + 16;
+}
+
+// Blue noise point set on a torus of size length x width (Bridson's algorithm):
+// every two points are at least radius apart along X or along Z, also across the borders,
+// so the set can be tiled along both axes and boxes up to radius wide centered on the points
+// never overlap. random(min, max) must return a uniform float in [min, max).
+// The points are returned sorted by decreasing x
+template <typename Random>
+void generatePoissonDisk(float radius, float length, float width, Random random,
+                         std::vector<float> &xs, std::vector<float> &zs, PoissonDiskScratch &scratch)
+{
+    const int capacity = poissonDiskCapacity(radius, length, width);
+
+    // Sized for the most points up front, so that calls with the same sizes never allocate again
+    scratch.reserve(capacity, radius);
+    SpatialHash &grid = scratch.grid;
+
+    xs.clear();
+    zs.clear();
+    xs.reserve(capacity);
+    zs.reserve(capacity);
+
+    auto wrap = [](float value, float period)
+    {
+        value = std::fmod(value, period);
+        return value < 0.0f ? value + period : value;
+    };
+
+    auto tooClose = [&](float x, float z)
+    {
+        auto test = [&](int i)
+        {
+            float dx = std::abs(x - xs[i]);
+            float dz = std::abs(z - zs[i]);
+            dx = std::min(dx, length - dx);
+            dz = std::min(dz, width - dz);
+
+            return std::max(dx, dz) < radius;
+        };
+
+        // Neighbours across a border are found looking around the images of the point,
+        // only needed within radius of that border
+        const int firstI = x > length - radius ? -1 : 0;
+        const int lastI = x < radius ? 1 : 0;
+        const int firstJ = z > width - radius ? -1 : 0;
+        const int lastJ = z < radius ? 1 : 0;
+
+        for (int i = firstI; i <= lastI; ++i)
+        {
+            for (int j = firstJ; j <= lastJ; ++j)
+            {
+                if (grid.anyNear(x + i * length, z + j * width, test))
+                {
+                    return true;
+                }
+            }
+        }
+
+        return false;
+    };
+
+    auto add = [&](float x, float z)
+    {
+        grid.insert(xs.size(), x, z);
+        xs.push_back(x);
+        zs.push_back(z);
+    };
+
+    std::vector<int> &active = scratch.active;
+    active.clear();
+    add(random(0.0f, length), random(0.0f, width));
+    active.push_back(0);
+
+    while (!active.empty() && static_cast<int>(xs.size()) < capacity)
+    {
+        int pick = static_cast<int>(random(0.0f, static_cast<float>(active.size())));
+        pick = std::min(pick, static_cast<int>(active.size()) - 1);
+        const int p = active[pick];
+        bool found = false;
+
+        for (int attempt = 0; attempt < POISSON_DISK_ATTEMPTS && !found; ++attempt)
+        {
+            float angle = random(0.0f, 6.2831853f);
+            float distance = random(radius, 2.0f * radius);
+            float x = wrap(xs[p] + distance * std::cos(angle), length);
+            float z = wrap(zs[p] + distance * std::sin(angle), width);
+
+            if (!tooClose(x, z))
+            {
+                active.push_back(xs.size());
+                add(x, z);
+                found = true;
+            }
+        }
+
+        if (!found)
+        {
+            active[pick] = active.back();
+            active.pop_back();
+        }
+    }
+
+    std::vector<int> &order = scratch.order;
+    order.resize(xs.size());
+    std::iota(order.begin(), order.end(), 0);
+    std::sort(order.begin(), order.end(), [&](int a, int b)
+              { return xs[a] > xs[b]; });
+
+    std::vector<float> &sortedX = scratch.sortedX;
+    std::vector<float> &sortedZ = scratch.sortedZ;
+    sortedX.resize(xs.size());
+    sortedZ.resize(zs.size());
+    for (size_t i = 0; i < order.size(); ++i)
+    {
+        sortedX[i] = xs[order[i]];
+        sortedZ[i] = zs[order[i]];
+    }
+
+    std::copy(sortedX.begin(), sortedX.end(), xs.begin());
+    std::copy(sortedZ.begin(), sortedZ.end(), zs.begin());
+}
@@ -0,0 +1,130 @@
+#pragma once
+
+#include <cstdint>
+
+const int RNG_LANES = 4;
+
+// SplitMix64, only used to expand seeds into generator states
+inline uint64_t splitMix64(uint64_t &state)
+{
+    uint64_t z = (state += 0x9E3779B97F4A7C15ull);
+    z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ull;
+    z = (z ^ (z >> 27)) * 0x94D049BB133111EBull;
+    return z ^ (z >> 31);
+}
+
+inline uint32_t rotl32(uint32_t x, int k)
+{
+    return (x << k) | (x >> (32 - k));
+}
+
+// 24 random bits to a float in [0, 1)
+inline float bitsToUnitFloat(uint32_t bits)
+{
+    return (bits >> 8) * (1.0f / 16777216.0f);
+}
+
+// xoshiro128+ stream: small, fast and reproducible from its seed.
+// Single draws and batch fills use separate states, the batch one being RNG_LANES
+// interleaved generators so that the fill loop has no dependency between lanes
+class RngStream
+{
+    uint32_t s[4];
+    uint32_t lanes[4][RNG_LANES];
+
+public:
+    void seed(uint64_t seed)
+    {
+        uint64_t state = seed;
+
+        for (int i = 0; i < 4; i += 2)
+        {
+            uint64_t value = splitMix64(state);
+            s[i] = static_cast<uint32_t>(value);
+            s[i + 1] = static_cast<uint32_t>(value >> 32);
+        }
+
+        for (int l = 0; l < RNG_LANES; ++l)
+        {
+            for (int i = 0; i < 4; i += 2)
+            {
+                uint64_t value = splitMix64(state);
+                lanes[i][l] = static_cast<uint32_t>(value);
+                lanes[i + 1][l] = static_cast<uint32_t>(value >> 32);
+            }
+        }
+    }
+
+    uint32_t next()
+    {
+        const uint32_t result = s[0] + s[3];
+        const uint32_t t = s[1] << 9;
+
+        s[2] ^= s[0];
+        s[3] ^= s[1];
+        s[1] ^= s[2];
+        s[0] ^= s[3];
+        s[2] ^= t;
+        s[3] = rotl32(s[3], 11);
+
+        return result;
+    }
+
+    // Uniform float in [min, max)
+    float uniform(float min, float max)
+    {
+        return min + (max - min) * bitsToUnitFloat(next());
+    }
+
+    // Fills out with n uniform floats in [min, max)
+    void fill(float *out, int n, float min, float max)
+    {
+        const float range = max - min;
+
+        for (int i = 0; i < n; i += RNG_LANES)
+        {
+            float values[RNG_LANES];
+
+            for (int l = 0; l < RNG_LANES; ++l)
+            {
+                const uint32_t result = lanes[0][l] + lanes[3][l];
+                const uint32_t t = lanes[1][l] << 9;
+
+                lanes[2][l] ^= lanes[0][l];
+                lanes[3][l] ^= lanes[1][l];
+                lanes[1][l] ^= lanes[2][l];
+                lanes[0][l] ^= lanes[3][l];
+                lanes[2][l] ^= t;
+                lanes[3][l] = rotl32(lanes[3][l], 11);
+
+                values[l] = min + range * bitsToUnitFloat(result);
+            }
+
+            for (int l = 0; l < RNG_LANES && i + l < n; ++l)
+            {
+                out[i + l] = values[l];
+            }
+        }
+    }
+};
+
+// Independent streams per subsystem, all derived from one seed:
+// drawing more from one of them never changes what the others produce
+struct Rng
+{
+    uint64_t seedValue = 0;
+
+    RngStream positions;
+    RngStream scales;
+    RngStream effects;
+
+    void seed(uint64_t seed)
+    {
+        uint64_t state = seed;
+        seedValue = seed;
+
+        positions.seed(splitMix64(state));
+        scales.seed(splitMix64(state));
+        effects.seed(splitMix64(state));
+    }
+};
@@ -0,0 +1,236 @@
+#pragma once
+
+#include <algorithm>
+#include <stdexcept>
+#include <vector>
+
+#include "collision_box.hpp"
+
+const float ROCK_Y = -0.4f;
+
+// Float arrays of a RockField, laid out one after the other
+enum RockColumn
+{
+    ColumnX,
+    ColumnZ,
+    ColumnPreviousX,
+    ColumnPreviousZ,
+    ColumnScale,
+    ColumnMinX,
+    ColumnMaxX,
+    ColumnMinZ,
+    ColumnMaxZ,
+    ROCK_COLUMNS
+};
+
+// Rocks stored as contiguous arrays (structure of arrays), so that the per step loops
+// only touch the fields they need. The extents are the model boundaries multiplied by the
+// rock scale: they are measured from the rock position and only change on respawn.
+// The arrays live either in the field's own storage or, attached, in a larger block
+// shared with other fields (see BatchRunner): a copy of an attached field views the same rocks
+class RockField
+{
+    std::vector<float> ownedColumns;
+    std::vector<int> ownedKinds;
+
+    int count = 0;
+    int capacity = 0;
+
+    // Scratch for permute
+    std::vector<float> permutedColumn;
+    std::vector<int> permutedKinds;
+
+    void bind(float *columns, int *kinds, int columnCapacity)
+    {
+        capacity = columnCapacity;
+        kind = kinds;
+        x = columns + ColumnX * capacity;
+        z = columns + ColumnZ * capacity;
+        previousX = columns + ColumnPreviousX * capacity;
+        previousZ = columns + ColumnPreviousZ * capacity;
+        scale = columns + ColumnScale * capacity;
+        minX = columns + ColumnMinX * capacity;
+        maxX = columns + ColumnMaxX * capacity;
+        minZ = columns + ColumnMinZ * capacity;
+        maxZ = columns + ColumnMaxZ * capacity;
+    }
+
+    bool isOwner() const
+    {
+        return !ownedColumns.empty() && x == ownedColumns.data();
+    }
+
+public:
+    int *kind = nullptr;
+
+    float *x = nullptr;
+    float *z = nullptr;
+    float *previousX = nullptr;
+    float *previousZ = nullptr;
+
+    float *scale = nullptr;
+
+    float *minX = nullptr;
+    float *maxX = nullptr;
+    float *minZ = nullptr;
+    float *maxZ = nullptr;
+
+    RockField() = default;
+
+    RockField(const RockField &other)
+    {
+        *this = other;
+    }
+
+    RockField &operator=(const RockField &other)
+    {
+        if (this == &other)
+        {
+            return *this;
+        }
+
+        count = other.count;
+
+        if (other.isOwner())
+        {
+            ownedColumns = other.ownedColumns;
+            ownedKinds = other.ownedKinds;
+            bind(ownedColumns.data(), ownedKinds.data(), other.capacity);
+        }
+        else
+        {
+            ownedColumns.clear();
+            ownedKinds.clear();
+            bind(other.x, other.kind, other.capacity);
+        }
+
+        return *this;
+    }
+
+    // Own storage for at least rockCapacity rocks; an attached field must already have it
+    void reserve(int rockCapacity)
+    {
+        if (rockCapacity <= capacity)
+        {
+            return;
+        }
+        if (x != nullptr && !isOwner())
+        {
+            throw std::runtime_error("rock capacity exceeds the attached storage!");
+        }
+
+        std::vector<float> columns(ROCK_COLUMNS * rockCapacity);
+        std::vector<int> kinds(rockCapacity);
+
+        for (int c = 0; c < ROCK_COLUMNS && count > 0; ++c)
+        {
+            std::copy(x + c * capacity, x + c * capacity + count, columns.begin() + c * rockCapacity);
+        }
+        std::copy(kind, kind + count, kinds.begin());
+
+        ownedColumns.swap(columns);
+        ownedKinds.swap(kinds);
+        bind(ownedColumns.data(), ownedKinds.data(), rockCapacity);
+    }
+
+    // Uses ROCK_COLUMNS * rockCapacity floats at columns and rockCapacity ints at kinds
+    void attach(float *columns, int *kinds, int rockCapacity)
+    {
+        ownedColumns.clear();
+        ownedKinds.clear();
+        count = 0;
+        bind(columns, kinds, rockCapacity);
+    }
+
+    int size() const
+    {
+        return count;
+    }
+
+    // Rocks the storage can hold: the float arrays are one block of ROCK_COLUMNS * capacity
+    // floats starting at x
+    int getCapacity() const
+    {
+        return capacity;
+    }
+
+    void clear()
+    {
+        count = 0;
+    }
+
+    void add(int rockKind, float posX, float posZ, float rockScale, const ModelBoundaries &boundaries)
+    {
+        if (count == capacity)
+        {
+            reserve(count == 0 ? 16 : 2 * count);
+        }
+
+        kind[count] = rockKind;
+        place(count++, posX, posZ, rockScale, boundaries);
+    }
+
+    // Moves rock i to a new position, e.g. on respawn, without interpolating across the jump
+    void place(int i, float posX, float posZ, float rockScale, const ModelBoundaries &boundaries)
+    {
+        x[i] = previousX[i] = posX;
+        z[i] = previousZ[i] = posZ;
+        scale[i] = rockScale;
+        minX[i] = boundaries.minX * rockScale;
+        maxX[i] = boundaries.maxX * rockScale;
+        minZ[i] = boundaries.minZ * rockScale;
+        maxZ[i] = boundaries.maxZ * rockScale;
+    }
+
+    // Reorders the rocks so that rock i becomes the old rock order[i]
+    void permute(const std::vector<int> &order)
+    {
+        permutedColumn.resize(count);
+        permutedKinds.resize(count);
+
+        for (int c = 0; c < ROCK_COLUMNS; ++c)
+        {
+            float *column = x + c * capacity;
+
+            for (int i = 0; i < count; ++i)
+            {
+                permutedColumn[i] = column[order[i]];
+            }
+            std::copy(permutedColumn.begin(), permutedColumn.end(), column);
+        }
+
+        for (int i = 0; i < count; ++i)
+        {
+            permutedKinds[i] = kind[order[i]];
+        }
+        std::copy(permutedKinds.begin(), permutedKinds.end(), kind);
+    }
+
+    void storePrevious()
+    {
+        std::copy(x, x + count, previousX);
+        std::copy(z, z + count, previousZ);
+    }
+
+    // Moves rocks [first, first + n) by (dx, dz), keeping their previous positions.
+    // Returns how many of them end up past limitX
+    int integrate(int first, int n, float dx, float dz, float limitX)
+    {
+        float *px = x + first;
+        float *pz = z + first;
+        float *ppx = previousX + first;
+        float *ppz = previousZ + first;
+        int passed = 0;
+
+        for (int i = 0; i < n; ++i)
+        {
+            ppx[i] = px[i];
+            ppz[i] = pz[i];
+            px[i] += dx;
+            pz[i] += dz;
+            passed += px[i] > limitX;
+        }
+
+        return passed;
+    }
+};
@@ -3,4 +3,5 @@ glslc shader.vert -o vert.spv
 glslc skybox.frag -o skyboxFrag.spv
 glslc skybox.vert -o skyboxVert.spv
 glslc text.frag -o textFrag.spv
-glslc text.vert -o textVert.spv 
\ No newline at end of file
+glslc text.vert -o textVert.spv
+glslc instanced.vert -o instancedVert.spv
\ No newline at end of file
@@ -0,0 +1,24 @@
+#version 450
+layout(binding = 0) uniform UniformBufferObject {
+	mat4 model;
+	mat4 view;
+	mat4 proj;
+} ubo;
+layout(location = 0) in vec3 pos;
+layout(location = 1) in vec3 norm;
+layout(location = 2) in vec2 texCoord;
+
+// Per instance model matrix, applied before the one of the draw
+layout(location = 3) in mat4 instanceModel;
+
+layout(location = 0) out vec3 fragViewDir;
+layout(location = 1) out vec3 fragNorm;
+layout(location = 2) out vec2 fragTexCoord;
+
+void main() {
+	mat4 model = ubo.model * instanceModel;
+	gl_Position = ubo.proj * ubo.view * model * vec4(pos, 1.0);
+	fragViewDir  = (ubo.view[3]).xyz - (model * vec4(pos,  1.0)).xyz;
+	fragNorm     = (model * vec4(norm, 0.0)).xyz;
+	fragTexCoord = texCoord;
+}
@@ -0,0 +1,116 @@
+#pragma once
+
+#include <vector>
+
+#include <glm/glm.hpp>
+
+#include "game_core.hpp"
+
+// One boat of a SharedCourse. Boats move along Z instead of the rocks, as they all share them
+struct CourseBoat
+{
+    float z = 0.0f;
+    float yaw = 0.0f;
+    float previousYaw = 0.0f;
+
+    bool afloat = true;
+
+    // Steps it stayed afloat in the current game
+    long steps = 0;
+};
+
+// Several boats on the same course, e.g. for split screen or many agents at once: one rock
+// field, points and speed for all of them. The course is stepped once, which also keeps its
+// broadphase order up to date, then every boat afloat queries that order for the few rocks
+// around it, so that a step costs about rocks + boats * log(rocks), not rocks * boats.
+// A boat that hits a rock sinks and the others go on; the game is lost when the last one sinks
+class SharedCourse
+{
+    void placeBoats()
+    {
+        const int n = boats.size();
+
+        for (int b = 0; b < n; ++b)
+        {
+            boats[b] = CourseBoat();
+            boats[b].z = MIN_Z + (MAX_Z - MIN_Z) * (b + 0.5f) / n;
+        }
+
+        afloat = n;
+    }
+
+public:
+    // Rock field and rules, always stepped straight: its own boat is not used
+    GameCore core;
+
+    std::vector<CourseBoat> boats;
+    int afloat = 0;
+
+    // Boats start spread evenly across the course
+    void init(uint64_t seed, int boatCount, const ModelBoundaries &boat, const std::vector<RockKind> &kinds,
+              const std::vector<int> &counts, const ConvexHull &boatShape = ConvexHull())
+    {
+        core.init(seed, boat, kinds, counts, boatShape);
+
+        boats.resize(boatCount);
+        placeBoats();
+    }
+
+    // Advances the course by delta seconds, then each boat afloat, steering boat b in horDirs[b]
+    // (-1, 0, 1) within the course. Pass SIM_STEP to get reproducible games
+    GameEvent step(double delta, const int *horDirs)
+    {
+        if (!core.game.started)
+        {
+            return Playing;
+        }
+
+        if (core.advance(delta, 0) == Win)
+        {
+            return Win;
+        }
+
+        const int n = boats.size();
+        for (int b = 0; b < n; ++b)
+        {
+            CourseBoat &boat = boats[b];
+
+            if (!boat.afloat)
+            {
+                continue;
+            }
+
+            boat.previousYaw = boat.yaw;
+            boat.yaw = 0.0f - horDirs[b] * BOAT_TURN_ANGLE;
+
+            // The rocks move by the opposite of the boat, relative to it
+            const float z = glm::clamp(boat.z - horDirs[b] * HORIZONTAL_SPEED * static_cast<float>(delta), MIN_Z, MAX_Z);
+            const BoatPose pose = {glm::vec2(BOAT_INIT_POS.x, z), boat.yaw, glm::vec2(core.stepDisplacement.x, boat.z - z)};
+            boat.z = z;
+
+            if (core.checkCollision(pose))
+            {
+                boat.afloat = false;
+                afloat--;
+            }
+            else
+            {
+                boat.steps++;
+            }
+        }
+
+        if (afloat == 0)
+        {
+            core.endGame();
+            return Lose;
+        }
+
+        return Playing;
+    }
+
+    void restart()
+    {
+        core.restart();
+        placeBoats();
+    }
+};
@@ -0,0 +1,78 @@
+#pragma once
+
+#include <cmath>
+#include <cstdint>
+#include <vector>
+
+// Uniform grid of square cells, hashed into a fixed number of buckets, indexing rocks by id.
+// The cell size must be at least the largest distance at which two rocks can interact,
+// so that looking at the 3x3 cells around a point finds every rock that can reach it
+class SpatialHash
+{
+    float cellSize = 1.0f;
+
+    uint32_t bucketMask = 0;
+    std::vector<int> heads;
+
+    // Per rock: next rock in its bucket
+    std::vector<int> next;
+
+    int cellCoord(double coord) const
+    {
+        return static_cast<int>(std::floor(coord / cellSize));
+    }
+
+    uint32_t bucket(int cellX, int cellZ) const
+    {
+        return (static_cast<uint32_t>(cellX) * 73856093u ^ static_cast<uint32_t>(cellZ) * 19349663u) & bucketMask;
+    }
+
+public:
+    void init(int capacity, float size)
+    {
+        cellSize = size;
+
+        uint32_t buckets = 16;
+        while (buckets < 2u * static_cast<uint32_t>(capacity))
+        {
+            buckets *= 2;
+        }
+
+        bucketMask = buckets - 1;
+        heads.assign(buckets, -1);
+        next.assign(capacity, -1);
+    }
+
+    void insert(int id, float x, float z)
+    {
+        uint32_t b = bucket(cellCoord(x), cellCoord(z));
+
+        next[id] = heads[b];
+        heads[b] = id;
+    }
+
+    // Calls test on the rocks in the 3x3 cells around (x, z) until it returns true.
+    // Rocks sharing a bucket with those cells may be tested too, possibly more than once
+    template <typename Test>
+    bool anyNear(float x, float z, Test test) const
+    {
+        const int cellX = cellCoord(x);
+        const int cellZ = cellCoord(z);
+
+        for (int i = -1; i <= 1; ++i)
+        {
+            for (int j = -1; j <= 1; ++j)
+            {
+                for (int id = heads[bucket(cellX + i, cellZ + j)]; id >= 0; id = next[id])
+                {
+                    if (test(id))
+                    {
+                        return true;
+                    }
+                }
+            }
+        }
+
+        return false;
+    }
+};
@@ -0,0 +1,71 @@
+#pragma once
+
+#include <atomic>
+#include <cstddef>
+
+// Bounded lock-free queue between exactly one producer thread and one consumer thread.
+// Capacity must be a power of two; push fails instead of waiting when the queue is full
+template <typename T, size_t Capacity>
+class SpscQueue
+{
+    static_assert(Capacity > 0 && (Capacity & (Capacity - 1)) == 0, "capacity must be a power of two");
+
+    T items[Capacity];
+
+    // Each index is written by one side only, on its own cache line
+    alignas(64) std::atomic<size_t> head{0};
+    alignas(64) std::atomic<size_t> tail{0};
+
+public:
+    // Producer side
+    bool push(const T &item)
+    {
+        const size_t t = tail.load(std::memory_order_relaxed);
+
+        if (t - head.load(std::memory_order_acquire) == Capacity)
+        {
+            return false;
+        }
+
+        items[t & (Capacity - 1)] = item;
+        tail.store(t + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Consumer side: the oldest item, left in the queue; null if empty
+    const T *front() const
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return nullptr;
+        }
+
+        return &items[h & (Capacity - 1)];
+    }
+
+    // Consumer side
+    bool pop(T &item)
+    {
+        const size_t h = head.load(std::memory_order_relaxed);
+
+        if (h == tail.load(std::memory_order_acquire))
+        {
+            return false;
+        }
+
+        item = items[h & (Capacity - 1)];
+        head.store(h + 1, std::memory_order_release);
+
+        return true;
+    }
+
+    // Only while neither side is running
+    void clear()
+    {
+        head.store(0, std::memory_order_relaxed);
+        tail.store(0, std::memory_order_relaxed);
+    }
+};
@@ -0,0 +1,58 @@
+#pragma once
+
+#include <chrono>
+
+// Parts of a step (and of a frame) that touch every rock or may grow with their number
+enum Stage
+{
+    StageSpawn,
+    StageIntegrate,
+    StageRespawn,
+    StageCollision,
+    StageUpload,
+    STAGES
+};
+
+const char *const STAGE_NAMES[STAGES] = {"spawn", "integrate", "respawn", "collision", "upload"};
+
+// Time spent in each stage, and how many times it ran
+struct StageTimings
+{
+    double seconds[STAGES] = {};
+    long runs[STAGES] = {};
+
+    void reset()
+    {
+        *this = StageTimings();
+    }
+};
+
+// Adds the time until the end of its scope to a stage; does nothing, not even reading
+// the clock, without timings
+class StageTimer
+{
+    StageTimings *timings;
+    Stage stage;
+    std::chrono::steady_clock::time_point start;
+
+public:
+    StageTimer(StageTimings *stageTimings, Stage timedStage) : timings(stageTimings), stage(timedStage)
+    {
+        if (timings != nullptr)
+        {
+            start = std::chrono::steady_clock::now();
+        }
+    }
+
+    ~StageTimer()
+    {
+        if (timings != nullptr)
+        {
+            timings->seconds[stage] += std::chrono::duration<double>(std::chrono::steady_clock::now() - start).count();
+            timings->runs[stage]++;
+        }
+    }
+
+    StageTimer(const StageTimer &) = delete;
+    StageTimer &operator=(const StageTimer &) = delete;
+};
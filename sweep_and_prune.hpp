@@ -0,0 +1,159 @@
+#pragma once
+
+#include <algorithm>
+#include <numeric>
+#include <vector>
+
+#include "rock_field.hpp"
+
+// Where the ring of a SweepAndPrune starts, and how far it looks around
+struct SweepAndPruneRing
+{
+    int head;
+    float maxExtent;
+};
+
+// Sweep and prune along X over the rock slots.
+// All the rocks move together, so their order along X only changes when one respawns:
+// the slots are kept sorted by decreasing X as a ring starting at head, and the rock that
+// leaves at MAX_X (the front) re-enters at MIN_X, behind all the others, becoming the back.
+// Respawned rocks must not get an X greater than any other rock, beyond rounding errors
+class SweepAndPrune
+{
+    int head = 0;
+
+    // Largest X extent of any rock, to widen the query interval
+    float maxExtent = 0.0f;
+
+    std::vector<int> order;
+
+    int slotAt(int position, int n) const
+    {
+        int slot = head + position;
+        return slot < n ? slot : slot - n;
+    }
+
+    void includeExtent(const RockField &rocks, int slot)
+    {
+        maxExtent = std::max(maxExtent, std::max(rocks.minX[slot], rocks.maxX[slot]));
+    }
+
+public:
+    // Sorts the rock slots physically by decreasing X; slot ids change
+    void build(RockField &rocks)
+    {
+        const int n = rocks.size();
+
+        order.resize(n);
+        std::iota(order.begin(), order.end(), 0);
+        std::sort(order.begin(), order.end(), [&](int a, int b)
+                  { return rocks.x[a] > rocks.x[b]; });
+
+        rocks.permute(order);
+
+        head = 0;
+        maxExtent = 0.0f;
+        for (int i = 0; i < n; ++i)
+        {
+            includeExtent(rocks, i);
+        }
+    }
+
+    // The ring of slots, valid as long as the rocks keep the order they had
+    SweepAndPruneRing getRing() const
+    {
+        return {head, maxExtent};
+    }
+
+    void setRing(const SweepAndPruneRing &ring)
+    {
+        head = ring.head;
+        maxExtent = ring.maxExtent;
+    }
+
+    // Slot of the rock with the largest X
+    int front() const
+    {
+        return head;
+    }
+
+    // The front rock has been respawned at MIN_X: it is now the back of the ring.
+    // Its X is clamped to the previous back, as the rounding of the moving positions
+    // can leave it a tiny bit ahead of it
+    void recycleFront(RockField &rocks)
+    {
+        const int n = rocks.size();
+        const int back = slotAt(n - 1, n);
+
+        if (rocks.x[head] > rocks.x[back])
+        {
+            rocks.x[head] = rocks.previousX[head] = rocks.x[back];
+        }
+
+        includeExtent(rocks, head);
+
+        if (++head == n)
+        {
+            head = 0;
+        }
+    }
+
+    // Calls visit(first, count) on the contiguous slot ranges of the rocks
+    // whose X interval may overlap [minX, maxX], at most two because of the ring
+    template <typename Visit>
+    void forEachCandidateRange(const RockField &rocks, float minX, float maxX, Visit visit) const
+    {
+        const int n = rocks.size();
+        const float *x = rocks.x;
+
+        // Positions are sorted by decreasing X: skip the rocks entirely past maxX...
+        int lo = 0, hi = n;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (x[slotAt(mid, n)] - maxExtent >= maxX)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        const int begin = lo;
+
+        // ...and stop before the rocks entirely before minX
+        hi = n;
+        while (lo < hi)
+        {
+            int mid = (lo + hi) / 2;
+            if (x[slotAt(mid, n)] + maxExtent > minX)
+            {
+                lo = mid + 1;
+            }
+            else
+            {
+                hi = mid;
+            }
+        }
+        const int end = lo;
+
+        if (begin == end)
+        {
+            return;
+        }
+
+        const int first = slotAt(begin, n);
+        const int count = end - begin;
+
+        if (first + count <= n)
+        {
+            visit(first, count);
+        }
+        else
+        {
+            visit(first, n - first);
+            visit(0, count - (n - first));
+        }
+    }
+};
@@ -0,0 +1,156 @@
+#pragma once
+
+#include <atomic>
+#include <condition_variable>
+#include <mutex>
+#include <thread>
+#include <vector>
+
+// Fixed set of worker threads running batches of indexed tasks.
+// The calling thread takes part in each batch, so a pool of size 1 has no workers at all.
+// Tasks are passed by reference and never copied, so running a batch does not allocate
+class ThreadPool
+{
+    std::vector<std::thread> workers;
+
+    std::mutex mutex;
+    std::condition_variable wake;
+    std::condition_variable done;
+
+    // Current batch, only changed under the mutex while no worker is busy
+    void *job = nullptr;
+    void (*invoke)(void *, int) = nullptr;
+    int taskCount = 0;
+    unsigned long generation = 0;
+    bool stopping = false;
+
+    std::atomic<int> nextTask{0};
+    std::atomic<int> pending{0};
+    int busy = 0;
+
+    void work(void *currentJob, void (*currentInvoke)(void *, int), int currentCount)
+    {
+        int i;
+        while ((i = nextTask.fetch_add(1)) < currentCount)
+        {
+            currentInvoke(currentJob, i);
+
+            if (pending.fetch_sub(1) == 1)
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                done.notify_all();
+            }
+        }
+    }
+
+    void workerLoop()
+    {
+        unsigned long seenGeneration = 0;
+
+        while (true)
+        {
+            void *currentJob;
+            void (*currentInvoke)(void *, int);
+            int currentCount;
+
+            {
+                std::unique_lock<std::mutex> lock(mutex);
+                wake.wait(lock, [&]
+                          { return stopping || generation != seenGeneration; });
+
+                if (stopping)
+                {
+                    return;
+                }
+
+                seenGeneration = generation;
+                currentJob = job;
+                currentInvoke = invoke;
+                currentCount = taskCount;
+                busy++;
+            }
+
+            work(currentJob, currentInvoke, currentCount);
+
+            {
+                std::lock_guard<std::mutex> lock(mutex);
+                busy--;
+            }
+            done.notify_all();
+        }
+    }
+
+public:
+    explicit ThreadPool(int threads)
+    {
+        for (int i = 1; i < threads; ++i)
+        {
+            workers.emplace_back([this]
+                                 { workerLoop(); });
+        }
+    }
+
+    ~ThreadPool()
+    {
+        {
+            std::lock_guard<std::mutex> lock(mutex);
+            stopping = true;
+        }
+        wake.notify_all();
+
+        for (auto &worker : workers)
+        {
+            worker.join();
+        }
+    }
+
+    ThreadPool(const ThreadPool &) = delete;
+    ThreadPool &operator=(const ThreadPool &) = delete;
+
+    // Threads taking part in a batch, the caller included
+    int size() const
+    {
+        return static_cast<int>(workers.size()) + 1;
+    }
+
+    // Runs task(i) for every i in [0, tasks) and returns when they are all done
+    template <typename Task>
+    void run(int tasks, Task &task)
+    {
+        if (workers.empty() || tasks <= 1)
+        {
+            for (int i = 0; i < tasks; ++i)
+            {
+                task(i);
+            }
+            return;
+        }
+
+        auto taskInvoke = [](void *t, int i)
+        {
+            (*static_cast<Task *>(t))(i);
+        };
+
+        std::unique_lock<std::mutex> lock(mutex);
+
+        // A worker that woke late for the previous batch may still hold its job:
+        // resetting nextTask under it would let it run a task of this batch on that job
+        done.wait(lock, [&]
+                  { return busy == 0; });
+
+        job = &task;
+        invoke = taskInvoke;
+        taskCount = tasks;
+        nextTask = 0;
+        pending = tasks;
+        generation++;
+        lock.unlock();
+        wake.notify_all();
+
+        work(&task, taskInvoke, tasks);
+
+        lock.lock();
+        done.wait(lock, [&]
+                  { return pending == 0 && busy == 0; });
+    }
+};
@@ -0,0 +1,43 @@
+#pragma once
+
+#include <atomic>
+
+// Latest value handoff between one writer thread and one reader thread, without locks or waits.
+// The writer fills its own slot and publishes it; the reader always gets the most recently
+// published slot, which the writer cannot touch until the reader moves on to a newer one.
+// Values published in between are skipped
+template <typename T>
+class TripleBuffer
+{
+    // Set in middle when it holds a value the reader has not taken yet
+    static const int FRESH = 4;
+
+    T slots[3];
+
+    int back = 0;
+    std::atomic<int> middle{1};
+    int front = 2;
+
+public:
+    // Writer side: the slot to fill before publish
+    T &writeSlot()
+    {
+        return slots[back];
+    }
+
+    void publish()
+    {
+        back = middle.exchange(back | FRESH, std::memory_order_acq_rel) & ~FRESH;
+    }
+
+    // Reader side: the latest published value, or the one read last time if there is none newer
+    const T &read()
+    {
+        if (middle.load(std::memory_order_relaxed) & FRESH)
+        {
+            front = middle.exchange(front, std::memory_order_acq_rel) & ~FRESH;
+        }
+
+        return slots[front];
+    }
+};